@@ -0,0 +1,172 @@
+// Host check of the asset pack format: opens a pack built by Tools/mkassetpack
+// from Host/assets/assets.txt, looks its assets up, draws them into RA8875Sim
+// and reads the pixels back, then makes sure damaged copies are refused.
+//   pack_check <pack>
+// Exits with 1 when a check fails.
+#include "ra8875.h"
+#include "ra8875_sim.h"
+#include "ra8875_pack.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+static RA8875Sim sim;
+static int failures = 0;
+
+static void expect(const char* name, bool ok)
+{
+	if (ok) return;
+	printf("FAIL %s\n", name);
+	failures++;
+}
+
+static void check(const char* name, uint16_t x, uint16_t y, uint16_t expected)
+{
+	uint16_t got = sim.pixel(0, x, y);
+	if (got == expected) return;
+	printf("FAIL %s: pixel %u,%u is %04X, expected %04X\n", name, x, y, got, expected);
+	failures++;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) return false;
+	fseek(f, 0, SEEK_END);
+	data.resize(ftell(f));
+	fseek(f, 0, SEEK_SET);
+	bool ok = !data.empty() && fread(&data[0], 1, data.size(), f) == data.size();
+	fclose(f);
+	return ok;
+}
+
+// Writes the damaged copy next to the pack and expects open() to refuse it
+static void expectRejected(RA8875AssetPack& pack, const char* name, const std::string& path, const std::vector<uint8_t>& data)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f == NULL || fwrite(&data[0], 1, data.size(), f) != data.size())
+	{
+		printf("FAIL %s: cannot write %s\n", name, path.c_str());
+		failures++;
+		if (f) fclose(f);
+		return;
+	}
+	fclose(f);
+	expect(name, !pack.open(path.c_str()));
+	remove(path.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: %s <pack>\n", argv[0]);
+		return 1;
+	}
+	SPISimBackend::attach(0, &sim);
+	RA8875 tft;
+	if (!tft.initialize(RA8875_800x480))
+	{
+		printf("FAIL initialize\n");
+		return 1;
+	}
+	tft.setMode(GRAPHIC);
+	tft.fillScreen(RGB(0, 0, 64));
+
+	RA8875AssetPack pack(&tft);
+	if (!pack.open(argv[1]))
+	{
+		printf("FAIL open %s\n", argv[1]);
+		return 1;
+	}
+	expect("count", pack.count() == 3);
+	expect("find missing", pack.find("missing") == NULL);
+	const AssetPackEntry* swatch = pack.find("swatch");
+	const AssetPackEntry* mask = pack.find("swatch_mask");
+	const AssetPackEntry* small = pack.find("small");
+	if (swatch == NULL || mask == NULL || small == NULL)
+	{
+		printf("FAIL find\n");
+		return 1;
+	}
+	expect("swatch entry", swatch->type == ASSET_RGB565 && swatch->w == 4 && swatch->h == 2);
+	expect("mask entry", mask->type == ASSET_MONO && mask->w == 4 && mask->h == 2);
+	expect("font entry", small->type == ASSET_FONT && small->glyphs == 3 && small->h == 8 && small->ascent == 6);
+
+	// Glyphs were listed B, space, A in the BDF and must come back sorted
+	const AssetPackGlyph* a = pack.glyph(small, 'A');
+	const AssetPackGlyph* b = pack.glyph(small, 'B');
+	expect("glyph A", a != NULL && a->w == 3 && a->h == 4 && a->xOffset == 0 && a->yOffset == 2 && a->advance == 4);
+	expect("glyph B", b != NULL && b->w == 2 && b->h == 2 && b->xOffset == 1 && b->yOffset == 3 && b->advance == 3);
+	expect("glyph missing", pack.glyph(small, 'C') == NULL);
+	expect("textWidth", pack.textWidth("small", "A B") == 9);
+
+	// Red, green, blue, white / black, gray, transparent white, yellow
+	static const uint16_t swatchPixels[8] = { 0xF800, 0x07E0, 0x001F, 0xFFFF, 0x0000, 0x8410, 0xFFFF, 0xFFE0 };
+	static const bool maskBits[8] = { false, true, false, true, false, true, false, true };
+	expect("draw swatch", pack.draw("swatch", 10, 10));
+	expect("draw mask", pack.draw(mask, 20, 10, RGB(255, 0, 255), RGB(0, 0, 0), false));
+	tft.flush();
+	for (int i = 0; i < 8; i++)
+	{
+		check("swatch", 10 + (i & 3), 10 + (i >> 2), swatchPixels[i]);
+		check("mask", 20 + (i & 3), 10 + (i >> 2), maskBits[i] ? RGB(255, 0, 255) : RGB(0, 0, 0));
+	}
+
+	expect("drawText", pack.drawText("small", 100, 50, "AB", RGB(255, 255, 0)) == 107);
+	tft.flush();
+	check("glyph A", 100, 52, RGB(255, 255, 0));
+	check("glyph A", 102, 52, RGB(255, 255, 0));
+	check("glyph A", 100, 53, RGB(255, 255, 0));
+	check("glyph A", 101, 53, RGB(0, 0, 64));
+	check("glyph B", 105, 53, RGB(255, 255, 0));
+	check("glyph B", 106, 54, RGB(255, 255, 0));
+	check("glyph B", 105, 54, RGB(0, 0, 64));
+	pack.close();
+
+	std::vector<uint8_t> data;
+	if (!readFile(argv[1], data) || data.size() < sizeof(AssetPackHeader))
+	{
+		printf("FAIL read %s\n", argv[1]);
+		return 1;
+	}
+	std::string bad = std::string(argv[1]) + ".bad";
+	AssetPackHeader header;
+	memcpy(&header, &data[0], sizeof(header));
+
+	std::vector<uint8_t> copy = data;
+	copy[0] ^= 0xFF;
+	expectRejected(pack, "reject magic", bad, copy);
+
+	copy = data;
+	copy.pop_back();
+	expectRejected(pack, "reject truncated", bad, copy);
+
+	// Entries are sorted by name, swap the first two
+	copy = data;
+	AssetPackEntry* entries = (AssetPackEntry*)&copy[header.tableOffset];
+	std::swap(entries[0], entries[1]);
+	expectRejected(pack, "reject entry order", bad, copy);
+
+	// Glyphs are sorted by codepoint, a duplicate breaks the lookup
+	copy = data;
+	entries = (AssetPackEntry*)&copy[header.tableOffset];
+	for (uint16_t i = 0; i < header.count; i++)
+	{
+		if (entries[i].type != ASSET_FONT) continue;
+		AssetPackGlyph* glyphs = (AssetPackGlyph*)&copy[entries[i].offset];
+		glyphs[1].codepoint = glyphs[0].codepoint;
+	}
+	expectRejected(pack, "reject duplicate codepoint", bad, copy);
+
+	copy = data;
+	entries = (AssetPackEntry*)&copy[header.tableOffset];
+	entries[0].size += 2;
+	expectRejected(pack, "reject entry size", bad, copy);
+
+	printf("%s: %u assets, %s\n", argv[1], header.count, failures ? "FAILED" : "ok");
+	tft.deinitialize();
+	return failures ? 1 : 0;
+}
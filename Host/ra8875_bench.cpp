@@ -0,0 +1,544 @@
+// Host benchmark: runs RA8875 drawing calls against RA8875Sim, prints the
+// simulated bus and engine time of each and checks the resulting pixels.
+// Comparisons print the bytes of both ways, e.g. batched against per call.
+//   ra8875_bench [sclk_hz] [out.ppm]
+// Exits with 1 when a pixel check fails.
+#include "ra8875.h"
+#include "ra8875_regs.h"
+#include "ra8875_sim.h"
+#include "ra8875_fb.h"
+#include "ra8875_assets.h"
+#include "ra8875_image.h"
+#include "SPITrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <jpeglib.h>
+#include <png.h>
+
+static RA8875Sim sim;
+static int failures = 0;
+
+struct Mark
+{
+	uint64_t ns;
+	RA8875SimStats stats;
+};
+
+static Mark mark()
+{
+	Mark m = { sim.now(), sim.stats() };
+	return m;
+}
+
+static void report(const char* name, const Mark& from, uint32_t items)
+{
+	const RA8875SimStats& s = sim.stats();
+	uint64_t us = (sim.now() - from.ns) / 1000;
+	printf("%-24s %8llu us %9llu bytes %6u frames %6u busy reads", name, (unsigned long long)us,
+		(unsigned long long)(s.bytes - from.stats.bytes), s.frames - from.stats.frames, s.busyReads - from.stats.busyReads);
+	if (items && us) printf(" %8llu /s", (unsigned long long)items * 1000000 / us);
+	printf("\n");
+}
+
+static void check(const char* name, uint16_t x, uint16_t y, uint16_t expected)
+{
+	uint16_t got = sim.pixel(0, x, y);
+	if (got == expected) return;
+	printf("FAIL %s: pixel %u,%u is %04X, expected %04X\n", name, x, y, got, expected);
+	failures++;
+}
+
+static void expect(const char* name, bool ok)
+{
+	if (ok) return;
+	printf("FAIL %s\n", name);
+	failures++;
+}
+
+// Compares a w x h block of a layer with the expected pixels, reports the first difference
+static void checkBlock(const char* name, uint8_t layer, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t* expected)
+{
+	for (uint16_t row = 0; row < h; row++)
+	{
+		for (uint16_t col = 0; col < w; col++)
+		{
+			uint16_t got = sim.pixel(layer, x + col, y + row);
+			if (got == expected[row * w + col]) continue;
+			printf("FAIL %s: layer %u pixel %u,%u is %04X, expected %04X\n", name, layer + 1, x + col, y + row, got, expected[row * w + col]);
+			failures++;
+			return;
+		}
+	}
+}
+
+static void readBlock(uint8_t layer, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t* out)
+{
+	for (uint16_t row = 0; row < h; row++)
+	{
+		for (uint16_t col = 0; col < w; col++) out[row * w + col] = sim.pixel(layer, x + col, y + row);
+	}
+}
+
+static uint64_t bytesSince(const Mark& from)
+{
+	return sim.stats().bytes - from.stats.bytes;
+}
+
+static uint16_t rgb565(const uint8_t* p)
+{
+	return RGB(p[0], p[1], p[2]);
+}
+
+// Test images for the decoder, encoded in memory
+static bool encodePng(const uint8_t* rgb, uint32_t w, uint32_t h, std::vector<uint8_t>& out)
+{
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = w;
+	image.height = h;
+	image.format = PNG_FORMAT_RGB;
+	png_alloc_size_t size = 0;
+	if (!png_image_write_to_memory(&image, NULL, &size, 0, rgb, 0, NULL)) return false;
+	out.resize(size);
+	return png_image_write_to_memory(&image, &out[0], &size, 0, rgb, 0, NULL) != 0;
+}
+
+static void encodeJpeg(const uint8_t* rgb, uint32_t w, uint32_t h, std::vector<uint8_t>& out)
+{
+	jpeg_compress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	unsigned char* buffer = NULL;
+	unsigned long size = 0;
+	jpeg_mem_dest(&cinfo, &buffer, &size);
+	cinfo.image_width = w;
+	cinfo.image_height = h;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 100, TRUE);
+	// No chroma subsampling, the color blocks stay flat up to their edges
+	cinfo.comp_info[0].h_samp_factor = 1;
+	cinfo.comp_info[0].v_samp_factor = 1;
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < h)
+	{
+		JSAMPROW row = (JSAMPROW)(rgb + cinfo.next_scanline * w * 3);
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	out.assign(buffer, buffer + size);
+	jpeg_destroy_compress(&cinfo);
+	free(buffer);
+}
+
+// JPEG is lossy: every channel may be off by a step of its RGB565 field
+static bool near565(uint16_t a, uint16_t b)
+{
+	int dr = ((a >> 11) & 0x1F) - ((b >> 11) & 0x1F);
+	int dg = ((a >> 5) & 0x3F) - ((b >> 5) & 0x3F);
+	int db = (a & 0x1F) - (b & 0x1F);
+	return abs(dr) <= 1 && abs(dg) <= 2 && abs(db) <= 1;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1) sim.setSclk(strtoul(argv[1], NULL, 0));
+	SPISimBackend::attach(0, &sim);
+	RA8875 tft;
+	if (!tft.initialize(RA8875_800x480))
+	{
+		printf("FAIL initialize\n");
+		return 1;
+	}
+	printf("SCLK %u Hz, %ux%u\n", sim.sclk(), tft.get_width(), tft.get_height());
+	tft.setMode(GRAPHIC);
+
+	Mark m = mark();
+	tft.fillScreen(RGB(0, 0, 64));
+	tft.flush();
+	report("fillScreen", m, 1);
+	check("fillScreen", 799, 479, RGB(0, 0, 64));
+
+	m = mark();
+	for (int i = 0; i < 100; i++) tft.rectHelper(i * 7, i * 4, i * 7 + 39, i * 4 + 29, RGB(i * 2, 200, 0), true);
+	tft.flush();
+	report("filled rects", m, 100);
+	check("filled rects", 99 * 7 + 39, 99 * 4 + 29, RGB(198, 200, 0));
+
+	m = mark();
+	for (int i = 0; i < 100; i++) tft.circleHelper(400, 240, 5 + i * 2, RGB(255, i * 2, 0), false);
+	tft.flush();
+	report("circles", m, 100);
+	check("circles", 400 + 5, 240, RGB(255, 0, 0));
+
+	RA8875Primitive items[200];
+	for (int i = 0; i < 200; i++)
+	{
+		RA8875Primitive p = { PrimLine, false, 0, (int16_t)(i * 4), 0, (int16_t)(799 - i * 4), 479 };
+		items[i] = p;
+	}
+	m = mark();
+	tft.drawPrimitives(items, 200, RGB(255, 255, 255));
+	tft.flush();
+	report("primitive list lines", m, 200);
+	check("primitive list lines", 0, 0, RGB(255, 255, 255));
+
+	static uint16_t image[200 * 100];
+	for (int i = 0; i < 200 * 100; i++) image[i] = (uint16_t)(i * 37);
+	m = mark();
+	tft.drawImage(image, 300, 300, 200, 100);
+	report("drawImage 200x100", m, 200 * 100);
+	check("drawImage 200x100", 300 + 123, 300 + 45, image[45 * 200 + 123]);
+
+	RA8875Framebuffer fb(&tft);
+	fb.fillScreen(RGB(0, 0, 0));
+	fb.flushChanged();
+	fb.fillRect(10, 10, 50, 20, RGB(255, 0, 255));
+	m = mark();
+	fb.flushChanged();
+	report("tile diff flush", m, 0);
+	printf("%-24s %7u%% tiles %7u%% bytes skipped\n", "", fb.frameDiffStats().tilesSkipped(), fb.frameDiffStats().bytesSkipped());
+	check("tile diff flush", 59, 29, RGB(255, 0, 255));
+
+	// Block copies, raster operations and overlapping moves
+	static uint16_t block[64 * 32], expected[64 * 32];
+	for (int i = 0; i < 64 * 32; i++) block[i] = (uint16_t)(i * 113 + 7);
+	tft.drawImage(block, 0, 200, 64, 32);
+	m = mark();
+	tft.copyRect(0, 200, 64, 32, 100, 200);
+	tft.flush();
+	report("copyRect 64x32", m, 1);
+	checkBlock("copyRect", 0, 100, 200, 64, 32, block);
+	tft.copyRect(0, 200, 64, 32, 100, 200, RopNotSXorD);
+	tft.flush();
+	for (int i = 0; i < 64 * 32; i++) expected[i] = 0xFFFF;
+	checkBlock("copyRect ~(S ^ D)", 0, 100, 200, 64, 32, expected);
+	tft.drawImage(block, 200, 200, 64, 32);
+	tft.moveRect(200, 200, 64, 32, 8, 4);
+	tft.flush();
+	checkBlock("moveRect overlapping down right", 0, 208, 204, 64, 32, block);
+	tft.moveRect(208, 204, 64, 32, -8, -4);
+	tft.flush();
+	checkBlock("moveRect overlapping up left", 0, 200, 200, 64, 32, block);
+
+	// Color expansion, opaque and transparent
+	static uint8_t bits[20 * 3];
+	for (int i = 0; i < 20 * 3; i++) bits[i] = (uint8_t)(i * 37 + 11);
+	// drawImage left the active window on the moved block, the engine clips to it
+	tft.setActiveWindow(0, 0, 799, 479);
+	tft.rectHelper(300, 200, 399, 219, RGB(0, 0, 64), true);
+	m = mark();
+	tft.drawBitmap1bpp(300, 200, 19, 20, bits, RGB(255, 255, 255), RGB(255, 0, 0));
+	tft.flush();
+	report("drawBitmap1bpp 19x20", m, 1);
+	tft.drawBitmap1bpp(330, 200, 19, 20, bits, RGB(255, 255, 255), RGB(255, 0, 0), true);
+	tft.flush();
+	for (int opaque = 0; opaque < 2; opaque++)
+	{
+		for (int row = 0; row < 20; row++)
+		{
+			for (int col = 0; col < 19; col++)
+			{
+				bool set = (bits[row * 3 + (col >> 3)] & (0x80 >> (col & 7))) != 0;
+				expected[row * 19 + col] = set ? RGB(255, 255, 255) : opaque ? RGB(255, 0, 0) : RGB(0, 0, 64);
+			}
+		}
+		checkBlock(opaque ? "drawBitmap1bpp" : "drawBitmap1bpp transparent", 0, opaque ? 300 : 330, 200, 19, 20, expected);
+	}
+
+	// Scroll offsets wrap inside the window
+	tft.setScrollWindow(0, 0, 99, 49);
+	tft.scroll(-5, 3);
+	expect("scroll wrap left", tft.getScrollX() == 95 && tft.getScrollY() == 3);
+	tft.scroll(10, -5);
+	expect("scroll wrap up", tft.getScrollX() == 5 && tft.getScrollY() == 48);
+	tft.setScrollMode(ScrollLayer2);
+	tft.flush();
+	expect("scroll registers", (sim.reg(RA8875_HOFS0) | (sim.reg(RA8875_HOFS0 + 1) << 8)) == 5 &&
+		(sim.reg(RA8875_VOFS0) | (sim.reg(RA8875_VOFS0 + 1) << 8)) == 48 && (sim.reg(RA8875_LTPR0) >> 6) == ScrollLayer2);
+	tft.setScrollMode(ScrollBothLayers);
+	tft.setScrollWindow(0, 0, tft.get_width() - 1, tft.get_height() - 1);
+
+	// Scattered pixels, one by one and as runs. The lower half is cleared
+	// through the framebuffer so the host buffer drawPixels uses matches it.
+	static RA8875Pixel scatter[300];
+	srand(1);
+	for (int i = 0; i < 300; i++)
+	{
+		RA8875Pixel p = { (int16_t)(rand() % 800), (int16_t)(240 + rand() % 240), (uint16_t)rand() };
+		scatter[i] = p;
+	}
+	fb.fillRect(0, 240, 800, 240, RGB(0, 0, 0));
+	fb.flush();
+	m = mark();
+	for (int i = 0; i < 300; i++) tft.drawPixel(scatter[i].x, scatter[i].y, scatter[i].color);
+	tft.flush();
+	report("drawPixel 300 random", m, 300);
+	fb.fillRect(0, 240, 800, 240, RGB(0, 0, 0));
+	fb.flush();
+	m = mark();
+	tft.drawPixels(scatter, 300);
+	tft.flush();
+	report("drawPixels 300 random", m, 300);
+	for (int i = 0; i < 300; i++)
+	{
+		bool last = true;
+		for (int j = i + 1; j < 300 && last; j++) last = scatter[j].x != scatter[i].x || scatter[j].y != scatter[i].y;
+		if (!last) continue;
+		check("drawPixels", scatter[i].x, scatter[i].y, scatter[i].color);
+		expect("drawPixels host buffer", fb.pixels()[scatter[i].y * 800 + scatter[i].x] == scatter[i].color);
+	}
+	static RA8875Pixel blob[100 * 100];
+	for (int i = 0; i < 100 * 100; i++)
+	{
+		RA8875Pixel p = { (int16_t)(600 + i % 100), (int16_t)(300 + i / 100), (uint16_t)(i * 31) };
+		blob[(i * 7919) % (100 * 100)] = p;
+	}
+	m = mark();
+	tft.drawPixels(blob, 100 * 100);
+	tft.flush();
+	report("drawPixels 100x100 blob", m, 100 * 100);
+	for (int i = 0; i < 100 * 100; i++) check("drawPixels blob", blob[i].x, blob[i].y, blob[i].color);
+
+	// A dashboard redrawing 24 digit cells per frame through the framebuffer
+	fb.fillScreen(RGB(0, 0, 0));
+	fb.flush();
+	m = mark();
+	for (int frame = 0; frame < 10; frame++)
+	{
+		for (int cell = 0; cell < 24; cell++)
+		{
+			int16_t x = 20 + (cell % 6) * 120, y = 40 + (cell / 6) * 100;
+			fb.fillRect(x, y, 16, 32, RGB(0, 0, 0));
+			fb.fillRect(x + 2, y + (frame + cell) % 28, 12, 4, RGB(0, 255, 0));
+		}
+		fb.flush();
+	}
+	report("dashboard 10 frames", m, 10);
+	printf("%-24s %9llu bytes per frame, %u for a full frame\n", "", (unsigned long long)bytesSince(m) / 10, 800 * 480 * 2);
+	check("dashboard", 20 + 2, 40 + 9, RGB(0, 255, 0));
+	check("dashboard", 20 + 5 * 120 + 13, 40 + 3 * 100 + (9 + 23) % 28 + 3, RGB(0, 255, 0));
+	check("dashboard", 20, 40, RGB(0, 0, 0));
+
+	// A bar chart plus scatter plot as one primitive list, batched and per call
+	static RA8875Primitive chart[700];
+	for (int i = 0; i < 100; i++)
+	{
+		RA8875Primitive bar = { PrimFilledRect, true, RGB(i * 2, 100, (255 - i * 2)), (int16_t)(i * 8), (int16_t)(479 - (i * 37) % 200), (int16_t)(i * 8 + 5), 479 };
+		chart[i] = bar;
+	}
+	for (int i = 0; i < 600; i++)
+	{
+		RA8875Primitive point = { PrimPoint, false, 0, (int16_t)((i * 53) % 800), (int16_t)(240 + (i * 29) % 240), 0, 0 };
+		chart[100 + i] = point;
+	}
+	static uint16_t chartImage[800 * 240];
+	tft.rectHelper(0, 240, 799, 479, RGB(0, 0, 0), true);
+	m = mark();
+	tft.drawPrimitives(chart, 700, RGB(255, 255, 255), true);
+	tft.flush();
+	report("chart batched", m, 700);
+	uint64_t batchedBytes = bytesSince(m), batchedNs = sim.now() - m.ns;
+	readBlock(0, 0, 240, 800, 240, chartImage);
+	tft.rectHelper(0, 240, 799, 479, RGB(0, 0, 0), true);
+	m = mark();
+	tft.drawPrimitives(chart, 700, RGB(255, 255, 255), false);
+	tft.flush();
+	report("chart per call", m, 700);
+	printf("%-24s %7lld%% bytes %6lld%% time saved batched\n", "",
+		100 - (long long)(batchedBytes * 100 / bytesSince(m)), 100 - (long long)(batchedNs * 100 / (sim.now() - m.ns)));
+	checkBlock("chart batched = per call", 0, 0, 240, 800, 240, chartImage);
+
+	tft.setMode(TEXT);
+	tft.textColor(RGB(255, 255, 0), 0);
+	for (uint8_t scale = 0; scale < 2; scale++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "text x%u", scale + 1);
+		tft.textEnlarge(scale);
+		m = mark();
+		tft.textWrite(0, 100 + scale * 40, "VBAT=%04.2f TEMP=%04.1f", 3.87, 21.5);
+		report(name, m, 19);
+	}
+	if (tft.getError() != NoError)
+	{
+		printf("FAIL poll timeout\n");
+		failures++;
+	}
+
+	if (argc > 2) sim.savePPM(argv[2], 0);
+
+	// Double buffering and the asset cache need layer 2, which 16bpp only has
+	// up to 480 pixels wide
+	tft.setMode(GRAPHIC);
+	expect("beginFrame refused without layer 2", !tft.beginFrame());
+	RA8875AssetCache noLayer2(&tft, Layer2, 0, 0, 64, 32);
+	expect("asset cache refused without layer 2", !noLayer2.isValid());
+	if (!tft.initialize(RA8875_480x272))
+	{
+		printf("FAIL initialize 480x272\n");
+		return 1;
+	}
+	tft.setMode(GRAPHIC);
+	expect("layer 2 at 480x272", tft.hasLayer2());
+	tft.fillScreen(RGB(0, 0, 0));
+	tft.setFrameCopyBack(true);
+	expect("beginFrame", tft.beginFrame() && tft.getLayer() == Layer2);
+	tft.fillScreen(RGB(0, 0, 0));
+	tft.rectHelper(10, 10, 49, 29, RGB(255, 128, 0), true);
+	tft.addDamage(10, 10, 40, 20);
+	m = mark();
+	expect("endFrame", tft.endFrame());
+	report("endFrame copy back", m, 1);
+	expect("layer 2 shown", tft.getFrontLayer() == Layer2 && (sim.reg(RA8875_LTPR0) & 7) == OnlyLayer2);
+	expect("frame drawn hidden", sim.pixel(1, 10, 10) == RGB(255, 128, 0));
+	expect("frame copied back", sim.pixel(0, 49, 29) == RGB(255, 128, 0) && sim.pixel(0, 50, 30) == RGB(0, 0, 0));
+	expect("second beginFrame", tft.beginFrame() && tft.getLayer() == Layer1);
+	tft.rectHelper(100, 10, 139, 29, RGB(0, 128, 255), true);
+	tft.addDamage(100, 10, 40, 20);
+	expect("second endFrame", tft.endFrame() && tft.getFrontLayer() == Layer1 && (sim.reg(RA8875_LTPR0) & 7) == OnlyLayer1);
+	expect("second frame", sim.pixel(0, 100, 10) == RGB(0, 128, 255) && sim.pixel(0, 10, 10) == RGB(255, 128, 0) &&
+		sim.pixel(1, 139, 29) == RGB(0, 128, 255));
+
+	// Room for two 32x32 assets on the hidden layer 2, the third evicts
+	RA8875AssetCache cache(&tft, Layer2, 0, 200, 64, 32);
+	expect("asset cache valid", cache.isValid());
+	static uint16_t icons[3][32 * 32];
+	for (int k = 0; k < 3; k++)
+	{
+		for (int i = 0; i < 32 * 32; i++) icons[k][i] = (uint16_t)((k + 1) * 0x1111 + i * 3);
+	}
+	expect("asset upload", cache.upload(0, icons[0], 32, 32) && cache.upload(1, icons[1], 32, 32));
+	expect("asset draw", cache.draw(1, 100, 100) && cache.draw(0, 140, 100) && cache.draw(1, 180, 100));
+	expect("asset upload evicting", cache.upload(2, icons[2], 32, 32));
+	expect("asset evicted least recent", cache.stats().evictions == 1 && !cache.contains(0) && cache.contains(1) && cache.contains(2));
+	expect("evicted asset not drawn", !cache.draw(0, 220, 100));
+	m = mark();
+	expect("asset draw after eviction", cache.draw(2, 220, 100));
+	tft.flush();
+	report("asset cache draw 32x32", m, 1);
+	cache.draw(0, 260, 100, icons[0], 32, 32);
+	tft.flush();
+	checkBlock("asset 1", 0, 100, 100, 32, 32, icons[1]);
+	checkBlock("asset 0", 0, 140, 100, 32, 32, icons[0]);
+	checkBlock("asset 2", 0, 220, 100, 32, 32, icons[2]);
+	checkBlock("asset 0 uploaded again", 0, 260, 100, 32, 32, icons[0]);
+	expect("asset 0 back", cache.contains(0) && cache.stats().evictions == 2);
+
+	// Asynchronous uploads: fences, and staging buffers held by the caller are left alone
+	static uint16_t strip[100 * 20];
+	for (int i = 0; i < 100 * 20; i++) strip[i] = (uint16_t)(i * 29 + 3);
+	expect("startAsync", tft.startAsync(256));
+	m = mark();
+	SPIFence first = tft.drawImageAsync(strip, 10, 150, 100, 20);
+	uint16_t* held = tft.acquireImageBuffer();
+	for (int i = 0; i < 256; i++) held[i] = (uint16_t)(0xA5A5 ^ i);
+	SPIFence second = tft.drawImageAsync(strip, 10, 180, 100, 20);
+	expect("fences ordered", held != NULL && second > first && tft.waitFence(second, 1000));
+	report("drawImageAsync 2x 100x20", m, 2 * 100 * 20);
+	uint16_t* other = tft.acquireImageBuffer();
+	expect("every buffer held", other != NULL && tft.acquireImageBuffer() == NULL);
+	bool intact = true;
+	for (int i = 0; i < 256; i++) intact = intact && held[i] == (uint16_t)(0xA5A5 ^ i);
+	expect("held buffer untouched", intact);
+	for (int i = 0; i < 256; i++) other[i] = (uint16_t)(0x5A5A ^ i);
+	SPIFence third = tft.drawImageAsync(held, 200, 150, 16, 16);
+	SPIFence fourth = tft.drawImageAsync(other, 220, 150, 16, 16);
+	expect("in place fences", tft.waitFence(third, 1000) && tft.waitFence(fourth, 1000));
+	for (int i = 0; i < 256; i++) expected[i] = (uint16_t)(0xA5A5 ^ i);
+	checkBlock("drawImageAsync held buffer", 0, 200, 150, 16, 16, expected);
+	for (int i = 0; i < 256; i++) expected[i] = (uint16_t)(0x5A5A ^ i);
+	checkBlock("drawImageAsync second buffer", 0, 220, 150, 16, 16, expected);
+	checkBlock("drawImageAsync", 0, 10, 150, 100, 20, strip);
+	checkBlock("drawImageAsync one buffer free", 0, 10, 180, 100, 20, strip);
+
+	// Band decoder: a lossless PNG drawn synchronously, a JPEG of flat 8x8
+	// blocks through the async staging buffers
+	tft.stopAsync();
+	RA8875ImageDecoder decoder(&tft);
+	static uint8_t rgb[40 * 24 * 3];
+	for (int y = 0; y < 24; y++)
+	{
+		for (int x = 0; x < 40; x++)
+		{
+			uint8_t* p = &rgb[(y * 40 + x) * 3];
+			p[0] = x * 6;
+			p[1] = y * 10;
+			p[2] = (x + y) * 4;
+		}
+	}
+	std::vector<uint8_t> png;
+	expect("encode png", encodePng(rgb, 40, 24, png));
+	m = mark();
+	expect("drawPng", !png.empty() && decoder.drawPng(&png[0], png.size(), 300, 20));
+	tft.flush();
+	report("drawPng 40x24", m, 40 * 24);
+	for (int i = 0; i < 40 * 24; i++) expected[i] = rgb565(&rgb[i * 3]);
+	checkBlock("drawPng", 0, 300, 20, 40, 24, expected);
+
+	static const uint8_t flat[8][3] =
+	{
+		{ 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 255, 255, 255 },
+		{ 0, 0, 0 }, { 128, 128, 128 }, { 255, 255, 0 }, { 0, 255, 255 }
+	};
+	for (int y = 0; y < 16; y++)
+	{
+		for (int x = 0; x < 32; x++) memcpy(&rgb[(y * 32 + x) * 3], flat[(y >> 3) * 4 + (x >> 3)], 3);
+	}
+	std::vector<uint8_t> jpeg;
+	encodeJpeg(rgb, 32, 16, jpeg);
+	expect("startAsync", tft.startAsync(128));
+	m = mark();
+	expect("drawJpeg", decoder.drawJpeg(&jpeg[0], jpeg.size(), 300, 60));
+	tft.stopAsync();
+	tft.flush();
+	report("drawJpeg 32x16 async", m, 32 * 16);
+	uint32_t far = 0;
+	for (int i = 0; i < 32 * 16; i++) far += !near565(sim.pixel(0, 300 + i % 32, 60 + i / 32), rgb565(&rgb[i * 3]));
+	if (far)
+	{
+		printf("FAIL drawJpeg: %u pixels off\n", far);
+		failures++;
+	}
+	expect("decoder stats", decoder.stats().images == 2 && decoder.stats().bands >= 2);
+
+	// A session recorded on a second emulator and replayed into a third one
+	static RA8875Sim traced, replayed;
+	SPISimBackend::attach(1, &traced);
+	char tracePath[] = "/tmp/ra8875_bench_XXXXXX";
+	int fd = mkstemp(tracePath);
+	if (fd >= 0) close(fd);
+	SPITraceRecorder recorder;
+	expect("trace open", fd >= 0 && recorder.open(tracePath, SPI_TRACE_FULL));
+	{
+		RA8875 recorded(1);
+		recorded.setTrace(&recorder);
+		expect("traced initialize", recorded.initialize(RA8875_480x272));
+		recorded.setMode(GRAPHIC);
+		recorded.fillScreen(RGB(0, 32, 0));
+		recorded.circleHelper(100, 100, 40, RGB(255, 255, 0), true);
+		recorded.drawImage(block, 200, 50, 64, 32);
+		recorded.drawBitmap1bpp(300, 50, 19, 20, bits, RGB(255, 255, 255), RGB(255, 0, 0));
+		recorded.flush();
+		recorded.setTrace(NULL);
+	}
+	recorder.close();
+	SPITraceReplayer replayer;
+	SPITraceReplayStats replayStats;
+	memset(&replayStats, 0, sizeof(replayStats));
+	expect("trace replay", replayer.open(tracePath) && replayer.replay(&replayed, false, &replayStats));
+	unlink(tracePath);
+	printf("%-24s %6u records %9u bytes %6u rx mismatches\n", "trace replay", replayStats.records, replayStats.bytes, replayStats.rxMismatches);
+	expect("trace replay reads", replayStats.rxMismatches == 0);
+	expect("trace replay pixels", traced.pixel(0, 100, 100) == RGB(255, 255, 0) &&
+		memcmp(traced.layer(0), replayed.layer(0), RA8875_SIM_MAX_WIDTH * RA8875_SIM_MAX_HEIGHT * 2) == 0);
+
+	tft.deinitialize();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+#include "wiringPi.h"
+#include <time.h>
+
+static uint64_t nowMicros()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t epoch = nowMicros();
+
+void delay(unsigned int)
+{
+}
+
+void delayMicroseconds(unsigned int)
+{
+}
+
+unsigned int millis(void)
+{
+	return (nowMicros() - epoch) / 1000;
+}
+
+unsigned int micros(void)
+{
+	return nowMicros() - epoch;
+}
+
+void pinMode(int, int)
+{
+}
+
+void digitalWrite(int, int)
+{
+}
+
+int digitalRead(int)
+{
+	return 0;
+}
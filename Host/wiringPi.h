@@ -0,0 +1,26 @@
+#pragma once
+// Host stand-in for the parts of wiringPi the library uses, only on the include
+// path of the host build. millis() and micros() read the host's monotonic
+// clock. Delays return at once: the emulator's time moves with bus traffic
+// only, so sleeping would just stretch runs and let polling loops hit their
+// timeouts before the modelled engine is done. Pin calls do nothing.
+#include <stdint.h>
+
+#define LOW		0
+#define HIGH	1
+#define INPUT	0
+#define OUTPUT	1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void delay(unsigned int howLong);
+void delayMicroseconds(unsigned int howLong);
+unsigned int millis(void);
+unsigned int micros(void);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+// Asset pack file layout, shared by Tools/mkassetpack and RA8875AssetPack.
+// A header, then the entry table sorted by name, then the asset data. Every
+// data block starts on an ASSET_PACK_ALIGN boundary and is stored exactly as
+// it goes on the bus, so a mapped pack is drawn straight from the mapping.
+// Header and table fields are little endian like the Pi.
+
+#define ASSET_PACK_MAGIC		0x4B504152  // "RAPK"
+#define ASSET_PACK_VERSION		1
+#define ASSET_PACK_ALIGN		64
+#define ASSET_PACK_NAME			24
+
+typedef enum
+{
+	ASSET_RGB565 = 1,   ///< w x h pixels, RGB565 high byte first
+	ASSET_MONO   = 2,   ///< w x h bits, rows byte aligned, MSB leftmost, as RA8875::drawBitmap1bpp takes them
+	ASSET_FONT   = 3    ///< Glyph table sorted by codepoint, each glyph a mono bitmap
+} AssetTypeEnum;
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;         ///< Entries in the table
+	uint32_t tableOffset;
+	uint32_t fileSize;
+};
+
+struct AssetPackEntry
+{
+	char name[ASSET_PACK_NAME];     ///< Zero terminated
+	uint16_t type;                  ///< AssetTypeEnum
+	uint16_t glyphs;                ///< Font: glyph count
+	uint16_t w;                     ///< Image width, font: widest advance
+	uint16_t h;                     ///< Image height, font: line height
+	uint16_t ascent;                ///< Font: line top to baseline
+	uint16_t reserved;
+	uint32_t offset;                ///< Pixels, font: first AssetPackGlyph
+	uint32_t size;                  ///< Bytes at offset
+	uint32_t dataOffset;            ///< Font: glyph bitmaps, glyph offsets are relative to it
+};
+
+struct AssetPackGlyph
+{
+	uint32_t codepoint;
+	uint32_t offset;        ///< Bitmap, from the font's dataOffset
+	uint8_t w;
+	uint8_t h;
+	int8_t xOffset;         ///< From the pen position
+	int8_t yOffset;         ///< From the line top
+	uint8_t advance;
+	uint8_t reserved[3];
+};
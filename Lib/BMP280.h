@@ -16,7 +16,7 @@
 #ifndef __BMP280_H__
 #define __BMP280_H__
 
-#include <I2CDev.h>
+#include "I2Cdev.h"
 
 /*=========================================================================
     I2C ADDRESS/BITS/SETTINGS
@@ -0,0 +1,41 @@
+#pragma once
+
+// Compile time selection of the bus backends. Every backend of a bus offers
+// the same set of plain, non-virtual methods, so SPIdev and I2Cdev call
+// straight into the selected one.
+//   SPI: SPI_BACKEND_SPIDEV (/dev/spidevX.Y), SPI_BACKEND_SIM (SPISink), default bcm2835
+//   I2C: I2C_BACKEND_LINUX (/dev/i2c-1), I2C_BACKEND_SIM (register file), default bcm2835
+//   GPIO events: GPIO_BACKEND_BCM2835 (event detect), GPIO_BACKEND_SIM, default gpiochip
+
+#if defined(SPI_BACKEND_SPIDEV)
+#include "SPISpidev.h"
+typedef SPISpidevBackend SPIBackend;
+#elif defined(SPI_BACKEND_SIM)
+#include "SPISim.h"
+typedef SPISimBackend SPIBackend;
+#else
+#include "SPIBcm2835.h"
+typedef SPIBcm2835Backend SPIBackend;
+#endif
+
+#if defined(I2C_BACKEND_LINUX)
+#include "I2CLinux.h"
+typedef I2CLinuxBackend I2CBackend;
+#elif defined(I2C_BACKEND_SIM)
+#include "I2CSim.h"
+typedef I2CSimBackend I2CBackend;
+#else
+#include "I2CBcm2835.h"
+typedef I2CBcm2835Backend I2CBackend;
+#endif
+
+#if defined(GPIO_BACKEND_BCM2835)
+#include "GPIOBcm2835.h"
+typedef GPIOBcm2835Backend GPIOBackend;
+#elif defined(GPIO_BACKEND_SIM)
+#include "GPIOSim.h"
+typedef GPIOSimBackend GPIOBackend;
+#else
+#include "GPIOLinux.h"
+typedef GPIOLinuxBackend GPIOBackend;
+#endif
@@ -0,0 +1,62 @@
+#include "GPIOBcm2835.h"
+#include <bcm2835.h>
+#include <unistd.h>
+
+GPIOBcm2835Backend::GPIOBcm2835Backend()
+{
+	_pin = 0;
+	_edge = GPIO_EDGE_FALLING;
+	_open = false;
+}
+
+GPIOBcm2835Backend::~GPIOBcm2835Backend()
+{
+	close();
+}
+
+bool GPIOBcm2835Backend::open(uint32_t pin, GPIOEdgeEnum edge)
+{
+	close();
+	if (!bcm2835_init()) return false;
+	_pin = pin;
+	_edge = edge;
+	bcm2835_gpio_fsel(_pin, BCM2835_GPIO_FSEL_INPT);
+	if (edge & GPIO_EDGE_RISING) bcm2835_gpio_ren(_pin);
+	if (edge & GPIO_EDGE_FALLING) bcm2835_gpio_fen(_pin);
+	bcm2835_gpio_set_eds(_pin);
+	_open = true;
+	return true;
+}
+
+void GPIOBcm2835Backend::close()
+{
+	if (!_open) return;
+	if (_edge & GPIO_EDGE_RISING) bcm2835_gpio_clr_ren(_pin);
+	if (_edge & GPIO_EDGE_FALLING) bcm2835_gpio_clr_fen(_pin);
+	_open = false;
+}
+
+// 1 on an edge, 0 on timeout, -1 when not open
+int GPIOBcm2835Backend::wait(uint32_t timeoutMs)
+{
+	if (!_open) return -1;
+	uint32_t waited = 0;
+	while (!bcm2835_gpio_eds(_pin))
+	{
+		if (waited >= timeoutMs * 1000) return 0;
+		usleep(GPIO_BCM2835_POLL_US);
+		waited += GPIO_BCM2835_POLL_US;
+	}
+	bcm2835_gpio_set_eds(_pin);
+	return 1;
+}
+
+void GPIOBcm2835Backend::clear()
+{
+	if (_open) bcm2835_gpio_set_eds(_pin);
+}
+
+bool GPIOBcm2835Backend::level()
+{
+	return bcm2835_gpio_lev(_pin) == HIGH;
+}
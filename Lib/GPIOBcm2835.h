@@ -0,0 +1,25 @@
+#pragma once
+#include "GPIOTypes.h"
+
+#define GPIO_BCM2835_POLL_US	100
+
+// Edge events through the bcm2835 event detect registers. There is no
+// descriptor to sleep on, wait() checks the latched edge every
+// GPIO_BCM2835_POLL_US without touching any bus. Pins are BCM GPIO numbers.
+class GPIOBcm2835Backend
+{
+public:
+	GPIOBcm2835Backend();
+	~GPIOBcm2835Backend();
+	bool open(uint32_t pin, GPIOEdgeEnum edge);
+	void close();
+	bool isOpen() const { return _open; }
+	int wait(uint32_t timeoutMs);
+	void clear();
+	bool level();
+	int fd() const { return -1; }
+private:
+	uint8_t _pin;
+	GPIOEdgeEnum _edge;
+	bool _open;
+};
@@ -0,0 +1,69 @@
+#include "GPIOLinux.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+GPIOLinuxBackend::GPIOLinuxBackend()
+{
+	_eventFd = -1;
+}
+
+GPIOLinuxBackend::~GPIOLinuxBackend()
+{
+	close();
+}
+
+bool GPIOLinuxBackend::open(uint32_t pin, GPIOEdgeEnum edge)
+{
+	close();
+	int chipFd = ::open(GPIO_LINUX_CHIP, O_RDONLY);
+	if (chipFd < 0) return false;
+	struct gpioevent_request req;
+	memset(&req, 0, sizeof(req));
+	req.lineoffset = pin;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	req.eventflags = (edge & GPIO_EDGE_RISING ? GPIOEVENT_REQUEST_RISING_EDGE : 0) |
+		(edge & GPIO_EDGE_FALLING ? GPIOEVENT_REQUEST_FALLING_EDGE : 0);
+	strncpy(req.consumer_label, "term", sizeof(req.consumer_label) - 1);
+	int status_value = ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &req);
+	::close(chipFd); // the line stays requested through the event descriptor
+	if (status_value < 0) return false;
+	_eventFd = req.fd;
+	return true;
+}
+
+void GPIOLinuxBackend::close()
+{
+	if (_eventFd < 0) return;
+	::close(_eventFd);
+	_eventFd = -1;
+}
+
+// Blocks until an edge is queued: 1 on an edge, 0 on timeout, -1 on error
+int GPIOLinuxBackend::wait(uint32_t timeoutMs)
+{
+	if (_eventFd < 0) return -1;
+	struct pollfd pfd = { _eventFd, POLLIN, 0 };
+	int r = poll(&pfd, 1, timeoutMs);
+	if (r <= 0) return r;
+	struct gpioevent_data event;
+	if (read(_eventFd, &event, sizeof(event)) != sizeof(event)) return -1;
+	return 1;
+}
+
+// Drops edges that happened before now
+void GPIOLinuxBackend::clear()
+{
+	while (_eventFd >= 0 && wait(0) > 0);
+}
+
+bool GPIOLinuxBackend::level()
+{
+	struct gpiohandle_data data;
+	memset(&data, 0, sizeof(data));
+	if (_eventFd < 0 || ioctl(_eventFd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) return false;
+	return data.values[0] != 0;
+}
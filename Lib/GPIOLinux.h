@@ -0,0 +1,23 @@
+#pragma once
+#include "GPIOTypes.h"
+
+#define GPIO_LINUX_CHIP	"/dev/gpiochip0"
+
+// Edge events through the gpiochip character device. The kernel queues every
+// edge from open() on, and fd() can go into poll/epoll next to other sources.
+// Pins are BCM GPIO numbers.
+class GPIOLinuxBackend
+{
+public:
+	GPIOLinuxBackend();
+	~GPIOLinuxBackend();
+	bool open(uint32_t pin, GPIOEdgeEnum edge);
+	void close();
+	bool isOpen() const { return _eventFd >= 0; }
+	int wait(uint32_t timeoutMs);
+	void clear();
+	bool level();
+	int fd() const { return _eventFd; }
+private:
+	int _eventFd;
+};
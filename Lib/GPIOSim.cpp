@@ -0,0 +1,58 @@
+#include "GPIOSim.h"
+
+bool GPIOSimBackend::_levels[GPIO_SIM_PINS];
+uint32_t GPIOSimBackend::_edges[GPIO_SIM_PINS][2];
+
+GPIOSimBackend::GPIOSimBackend()
+{
+	_pin = 0;
+	_edge = GPIO_EDGE_FALLING;
+	_seen[0] = _seen[1] = 0;
+	_open = false;
+}
+
+// Counts rising edges in _edges[pin][0] and falling ones in _edges[pin][1]
+void GPIOSimBackend::setLevel(uint32_t pin, bool level)
+{
+	if (pin >= GPIO_SIM_PINS || _levels[pin] == level) return;
+	_levels[pin] = level;
+	_edges[pin][level ? 0 : 1]++;
+}
+
+bool GPIOSimBackend::open(uint32_t pin, GPIOEdgeEnum edge)
+{
+	if (pin >= GPIO_SIM_PINS) return false;
+	_pin = pin;
+	_edge = edge;
+	_open = true;
+	clear();
+	return true;
+}
+
+void GPIOSimBackend::close()
+{
+	_open = false;
+}
+
+int GPIOSimBackend::wait(uint32_t /* timeoutMs */)
+{
+	if (!_open) return -1;
+	for (int i = 0; i < 2; i++)
+	{
+		if (!(_edge & (i == 0 ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING)) || _seen[i] == _edges[_pin][i]) continue;
+		_seen[i]++;
+		return 1;
+	}
+	return 0;
+}
+
+void GPIOSimBackend::clear()
+{
+	_seen[0] = _edges[_pin][0];
+	_seen[1] = _edges[_pin][1];
+}
+
+bool GPIOSimBackend::level()
+{
+	return _levels[_pin];
+}
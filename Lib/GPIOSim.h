@@ -0,0 +1,27 @@
+#pragma once
+#include "GPIOTypes.h"
+
+#define GPIO_SIM_PINS	64
+
+// Simulated event lines. Tests drive a pin with setLevel(); wait() never blocks
+// since there is no real time to wait for, it reports a queued edge or a timeout.
+class GPIOSimBackend
+{
+public:
+	GPIOSimBackend();
+	bool open(uint32_t pin, GPIOEdgeEnum edge);
+	void close();
+	bool isOpen() const { return _open; }
+	int wait(uint32_t timeoutMs);
+	void clear();
+	bool level();
+	int fd() const { return -1; }
+	static void setLevel(uint32_t pin, bool level);
+private:
+	static bool _levels[GPIO_SIM_PINS];
+	static uint32_t _edges[GPIO_SIM_PINS][2];
+	uint32_t _pin;
+	GPIOEdgeEnum _edge;
+	uint32_t _seen[2];
+	bool _open;
+};
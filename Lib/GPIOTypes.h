@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// Edges a GPIO event line reports
+typedef enum
+{
+	GPIO_EDGE_RISING  = 0x01,
+	GPIO_EDGE_FALLING = 0x02,
+	GPIO_EDGE_BOTH    = 0x03
+} GPIOEdgeEnum;
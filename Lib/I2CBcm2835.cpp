@@ -0,0 +1,33 @@
+#include "I2CBcm2835.h"
+#include <bcm2835.h>
+
+bool I2CBcm2835Backend::initialize(uint32_t baudrate)
+{
+	if (!bcm2835_init()) return false;
+	bcm2835_i2c_set_baudrate(baudrate);
+	bcm2835_i2c_begin();
+	return true;
+}
+
+void I2CBcm2835Backend::begin()
+{
+	bcm2835_i2c_begin();
+}
+
+void I2CBcm2835Backend::end()
+{
+	bcm2835_i2c_end();
+}
+
+// Register reads use a repeated start between the address and the data phase
+bool I2CBcm2835Backend::writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength)
+{
+	bcm2835_i2c_setSlaveAddress(devAddr);
+	return bcm2835_i2c_write_read_rs((char*)tx, txLength, (char*)rx, rxLength) == BCM2835_I2C_REASON_OK;
+}
+
+bool I2CBcm2835Backend::write(uint8_t devAddr, const uint8_t* data, uint32_t length)
+{
+	bcm2835_i2c_setSlaveAddress(devAddr);
+	return bcm2835_i2c_write((const char*)data, length) == BCM2835_I2C_REASON_OK;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+// The BSC1 controller through the bcm2835 library
+class I2CBcm2835Backend
+{
+public:
+	static bool initialize(uint32_t baudrate);
+	static void begin();
+	static void end();
+	static bool writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength);
+	static bool write(uint8_t devAddr, const uint8_t* data, uint32_t length);
+};
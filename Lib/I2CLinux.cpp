@@ -0,0 +1,41 @@
+#include "I2CLinux.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+int I2CLinuxBackend::_fileHandle = -1;
+
+// The bus clock is set by the device tree (dtparam=i2c_arm_baudrate), baudrate is ignored
+bool I2CLinuxBackend::initialize(uint32_t /* baudrate */)
+{
+	if (_fileHandle < 0) _fileHandle = open(I2C_LINUX_DEVICE, O_RDWR);
+	return _fileHandle >= 0;
+}
+
+bool I2CLinuxBackend::writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength)
+{
+	struct i2c_msg msgs[2];
+	msgs[0].addr = devAddr;
+	msgs[0].flags = 0;
+	msgs[0].len = txLength;
+	msgs[0].buf = (uint8_t*)tx;
+	msgs[1].addr = devAddr;
+	msgs[1].flags = I2C_M_RD;
+	msgs[1].len = rxLength;
+	msgs[1].buf = rx;
+	struct i2c_rdwr_ioctl_data data = { msgs, 2 };
+	return ioctl(_fileHandle, I2C_RDWR, &data) == 2;
+}
+
+bool I2CLinuxBackend::write(uint8_t devAddr, const uint8_t* data, uint32_t length)
+{
+	struct i2c_msg msg;
+	msg.addr = devAddr;
+	msg.flags = 0;
+	msg.len = length;
+	msg.buf = (uint8_t*)data;
+	struct i2c_rdwr_ioctl_data rdwr = { &msg, 1 };
+	return ioctl(_fileHandle, I2C_RDWR, &rdwr) == 1;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+#define I2C_LINUX_DEVICE	"/dev/i2c-1"
+
+// The kernel i2c-dev interface. Each access is one I2C_RDWR ioctl, so the
+// address and data phases of a register read are joined by a repeated start.
+class I2CLinuxBackend
+{
+public:
+	static bool initialize(uint32_t baudrate);
+	static void begin() {}
+	static void end() {}
+	static bool writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength);
+	static bool write(uint8_t devAddr, const uint8_t* data, uint32_t length);
+private:
+	static int _fileHandle;
+};
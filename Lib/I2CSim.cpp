@@ -0,0 +1,26 @@
+#include "I2CSim.h"
+
+uint8_t I2CSimBackend::_registers[I2C_SIM_DEVICES][I2C_SIM_REGISTERS];
+
+uint8_t* I2CSimBackend::registers(uint8_t devAddr)
+{
+	return _registers[devAddr & (I2C_SIM_DEVICES - 1)];
+}
+
+bool I2CSimBackend::writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength)
+{
+	if (devAddr >= I2C_SIM_DEVICES || txLength == 0) return false;
+	uint8_t* regs = registers(devAddr);
+	uint8_t reg = tx[0];
+	for (uint32_t i = 0; i < rxLength; i++) rx[i] = regs[(uint8_t)(reg + i)];
+	return true;
+}
+
+bool I2CSimBackend::write(uint8_t devAddr, const uint8_t* data, uint32_t length)
+{
+	if (devAddr >= I2C_SIM_DEVICES || length == 0) return false;
+	uint8_t* regs = registers(devAddr);
+	uint8_t reg = data[0];
+	for (uint32_t i = 1; i < length; i++) regs[(uint8_t)(reg + i - 1)] = data[i];
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+#define I2C_SIM_DEVICES		128
+#define I2C_SIM_REGISTERS	256
+
+// Bus simulation: every 7 bit address is backed by a plain register file with
+// an auto incrementing register pointer, the first byte written selects it.
+// Tests preload or inspect a device through registers().
+class I2CSimBackend
+{
+public:
+	static bool initialize(uint32_t /* baudrate */) { return true; }
+	static void begin() {}
+	static void end() {}
+	static bool writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength);
+	static bool write(uint8_t devAddr, const uint8_t* data, uint32_t length);
+	static uint8_t* registers(uint8_t devAddr);
+private:
+	static uint8_t _registers[I2C_SIM_DEVICES][I2C_SIM_REGISTERS];
+};
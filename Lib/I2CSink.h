@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+// Receiver of I2C bus transactions: an optional register write followed by an
+// optional read from the same device. rx is NULL for write-only transactions,
+// ok is false when the device did not acknowledge.
+class I2CSink
+{
+public:
+	virtual ~I2CSink() {}
+	virtual void transaction(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, const uint8_t* rx, uint32_t rxLength, bool ok) = 0;
+};
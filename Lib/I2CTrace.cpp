@@ -0,0 +1,127 @@
+#include "I2CTrace.h"
+#include "SPITrace.h"
+#include "BusConfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////// Recorder
+
+I2CTraceRecorder::I2CTraceRecorder()
+{
+	_file = NULL;
+	_startNs = 0;
+}
+
+I2CTraceRecorder::~I2CTraceRecorder()
+{
+	close();
+}
+
+bool I2CTraceRecorder::open(const char* path)
+{
+	close();
+	_file = fopen(path, "wb");
+	if (_file == NULL) return false;
+	_startNs = spiTraceNow();
+	I2CTraceHeader header = { I2C_TRACE_MAGIC, I2C_TRACE_VERSION, 0 };
+	return fwrite(&header, sizeof(header), 1, _file) == 1;
+}
+
+void I2CTraceRecorder::close()
+{
+	if (_file == NULL) return;
+	fclose(_file);
+	_file = NULL;
+}
+
+void I2CTraceRecorder::transaction(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, const uint8_t* rx, uint32_t rxLength, bool ok)
+{
+	if (_file == NULL || txLength > 0xFFFF || rxLength > 0xFFFF) return;
+	I2CTraceRecord record;
+	record.timestampNs = spiTraceNow() - _startNs;
+	record.devAddr = devAddr;
+	record.flags = ok ? I2C_TRACE_FLAG_OK : 0;
+	record.txLength = txLength;
+	record.rxLength = rx ? rxLength : 0;
+	fwrite(&record, sizeof(record), 1, _file);
+	if (record.txLength) fwrite(tx, 1, record.txLength, _file);
+	if (record.rxLength) fwrite(rx, 1, record.rxLength, _file);
+}
+
+///////////////// Replayer
+
+I2CTraceReplayer::I2CTraceReplayer()
+{
+	_file = NULL;
+	_payload = NULL;
+	_payloadCapacity = 0;
+	_txLength = 0;
+}
+
+I2CTraceReplayer::~I2CTraceReplayer()
+{
+	close();
+	free(_payload);
+}
+
+bool I2CTraceReplayer::open(const char* path)
+{
+	close();
+	_file = fopen(path, "rb");
+	if (_file == NULL) return false;
+	I2CTraceHeader header;
+	if (fread(&header, sizeof(header), 1, _file) != 1 ||
+		header.magic != I2C_TRACE_MAGIC || header.version != I2C_TRACE_VERSION)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void I2CTraceReplayer::close()
+{
+	if (_file == NULL) return;
+	fclose(_file);
+	_file = NULL;
+}
+
+bool I2CTraceReplayer::next(I2CTraceRecord& record)
+{
+	if (_file == NULL || fread(&record, sizeof(record), 1, _file) != 1) return false;
+	uint32_t need = record.txLength + record.rxLength * 2;
+	if (need > _payloadCapacity)
+	{
+		uint8_t* payload = (uint8_t*)realloc(_payload, need);
+		if (payload == NULL) return false;
+		_payload = payload;
+		_payloadCapacity = need;
+	}
+	_txLength = record.txLength;
+	uint32_t stored = record.txLength + record.rxLength;
+	return fread(_payload, 1, stored, _file) == stored;
+}
+
+bool I2CTraceReplayer::replay(I2CTraceReplayStats* stats)
+{
+	I2CTraceReplayStats s;
+	memset(&s, 0, sizeof(s));
+	I2CTraceRecord record;
+	while (next(record))
+	{
+		s.records++;
+		s.bytes += record.txLength + record.rxLength;
+		if (record.txLength == 0) continue;
+		bool ok;
+		if (record.rxLength > 0)
+		{
+			uint8_t* replayed = _payload + record.txLength + record.rxLength;
+			ok = I2CBackend::writeRead(record.devAddr, tx(), record.txLength, replayed, record.rxLength);
+			if (ok && memcmp(replayed, rx(), record.rxLength) != 0) s.rxMismatches++;
+		}
+		else ok = I2CBackend::write(record.devAddr, tx(), record.txLength);
+		if (!ok) s.failures++;
+	}
+	if (stats) *stats = s;
+	return s.records > 0;
+}
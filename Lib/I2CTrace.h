@@ -0,0 +1,71 @@
+#pragma once
+#include "I2CSink.h"
+#include <stdio.h>
+
+#define I2C_TRACE_MAGIC		0x54433249  // "I2CT"
+#define I2C_TRACE_VERSION	1
+
+#define I2C_TRACE_FLAG_OK	0x01  // the device acknowledged
+
+#pragma pack(push, 1)
+struct I2CTraceHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+};
+
+// Every record is followed by txLength bytes sent and rxLength bytes read
+struct I2CTraceRecord
+{
+	uint64_t timestampNs;    ///< Nanoseconds since the recorder was opened
+	uint8_t devAddr;         ///< 7 bit device address
+	uint8_t flags;           ///< I2C_TRACE_FLAG_*
+	uint16_t txLength;
+	uint16_t rxLength;
+};
+#pragma pack(pop)
+
+struct I2CTraceReplayStats
+{
+	uint32_t records;
+	uint32_t bytes;
+	uint32_t failures;       ///< Transactions the backend did not complete
+	uint32_t rxMismatches;   ///< Reads where the backend answered differently than the recorded device
+};
+
+// Writes every transaction it receives to a binary log. Attach it with
+// I2Cdev::setTrace.
+class I2CTraceRecorder : public I2CSink
+{
+public:
+	I2CTraceRecorder();
+	~I2CTraceRecorder();
+	bool open(const char* path);
+	void close();
+	bool isOpen() const { return _file != NULL; }
+
+	virtual void transaction(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, const uint8_t* rx, uint32_t rxLength, bool ok);
+private:
+	FILE* _file;
+	uint64_t _startNs;
+};
+
+// Reads a trace back and sends it to the I2C backend compiled in
+class I2CTraceReplayer
+{
+public:
+	I2CTraceReplayer();
+	~I2CTraceReplayer();
+	bool open(const char* path);
+	void close();
+	bool next(I2CTraceRecord& record);
+	const uint8_t* tx() const { return _payload; }
+	const uint8_t* rx() const { return _payload + _txLength; }
+	bool replay(I2CTraceReplayStats* stats = NULL);
+private:
+	FILE* _file;
+	uint8_t* _payload;           ///< tx, recorded rx, then the replayed rx
+	uint32_t _payloadCapacity;
+	uint32_t _txLength;
+};
@@ -30,12 +30,12 @@ THE SOFTWARE.
 #include "I2Cdev.h"
 #include <stdio.h>
 
+I2CSink* I2Cdev::_trace = NULL;
+
 I2Cdev::I2Cdev() { }
 
 void I2Cdev::initialize() {
-	bcm2835_init();
-	bcm2835_i2c_set_baudrate(i2c_baudrate);
-	bcm2835_i2c_begin();
+	I2CBackend::initialize(i2c_baudrate);
 }
 
 /** Enable or disable I2C, 
@@ -44,12 +44,28 @@ void I2Cdev::initialize() {
 void I2Cdev::enable(bool isEnabled) {
   if ( set_I2C_pins ){
     if (isEnabled)
-      bcm2835_i2c_end();
+      I2CBackend::end();
     else
-      bcm2835_i2c_begin() ;
+      I2CBackend::begin();
   }
 }
 
+void I2Cdev::setTrace(I2CSink* trace) {
+	_trace = trace;
+}
+
+bool I2Cdev::writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength) {
+	bool response = I2CBackend::writeRead(devAddr, tx, txLength, rx, rxLength);
+	if (_trace) _trace->transaction(devAddr, tx, txLength, rx, rxLength, response);
+	return response;
+}
+
+bool I2Cdev::write(uint8_t devAddr, const uint8_t* data, uint32_t length) {
+	bool response = I2CBackend::write(devAddr, data, length);
+	if (_trace) _trace->transaction(devAddr, data, length, NULL, 0, response);
+	return response;
+}
+
 char sendBuf[256];
 char recvBuf[256];
 
@@ -62,12 +78,11 @@ char recvBuf[256];
  */
 int8_t I2Cdev::readBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t *data) {
 	enable(true);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 1);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 1);
 	*data = recvBuf[1] & (1 << bitNum);
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 /** Read multiple bits from an 8-bit device register.
@@ -85,18 +100,17 @@ int8_t I2Cdev::readBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint
   //    xxx   args: bitStart=4, length=3
   //    010   masked
   //   -> 010 shifted
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 1);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 1);
 	uint8_t b = (uint8_t) recvBuf[0];
-	if (response == BCM2835_I2C_REASON_OK) {
+	if (response) {
 		uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
 		b &= mask;
 		b >>= (bitStart - length + 1);
 		*data = b;
 	}
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK;
+	return response;
 }
 
 /** Read single byte from an 8-bit device register.
@@ -107,12 +121,11 @@ int8_t I2Cdev::readBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint
  */
 int8_t I2Cdev::readByte(uint8_t devAddr, uint8_t regAddr, uint8_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 1);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 1);
 	data[0] = (uint8_t) recvBuf[0];
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK;
+	return response;
 }
 
 /** Read multiple bytes from an 8-bit device register.
@@ -124,15 +137,14 @@ int8_t I2Cdev::readByte(uint8_t devAddr, uint8_t regAddr, uint8_t *data) {
  */
 int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, length);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, length);
 	int i;
 	for (i = 0; i < length; i++) {
 		data[i] = (uint8_t) recvBuf[i];
 	}
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK;
+	return response;
 }
 
 /** write a single bit in an 8-bit device register.
@@ -144,18 +156,17 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
  */
 bool I2Cdev::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	//first reading registery value
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 1);
-	if (response == BCM2835_I2C_REASON_OK) {
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 1);
+	if (response) {
 		uint8_t b = recvBuf[0];
 		b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
 		sendBuf[1] = b;
-		response = bcm2835_i2c_write(sendBuf, 2);
+		response = write(devAddr, (const uint8_t*)sendBuf, 2);
 	}
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK;
+	return response;
 }
 
 /** Write multiple bits in an 8-bit device register.
@@ -175,11 +186,10 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
   // 10100011 original & ~mask
   // 10101011 masked | value
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	//first reading registery value
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 1);
-	if (response == BCM2835_I2C_REASON_OK) {
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 1);
+	if (response) {
 		uint8_t b = recvBuf[0];
 		uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
 		data <<= (bitStart - length + 1); // shift data into correct position
@@ -187,10 +197,10 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
 		b &= ~(mask); // zero all important bits in existing byte
 		b |= data; // combine data with existing byte
 		sendBuf[1] = b;
-		response = bcm2835_i2c_write(sendBuf, 2);
+		response = write(devAddr, (const uint8_t*)sendBuf, 2);
 	}
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK;
+	return response;
 }
 
 /** Write single byte to an 8-bit device register.
@@ -201,12 +211,11 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
  */
 bool I2Cdev::writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
 	sendBuf[1] = data;
-	uint8_t response = bcm2835_i2c_write(sendBuf, 2);
+	bool response = write(devAddr, (const uint8_t*)sendBuf, 2);
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 /** Read single word from a 16-bit device register.
@@ -217,12 +226,11 @@ bool I2Cdev::writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t data) {
  */
 int8_t I2Cdev::readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, 2);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, 2);
 	data[0] = (recvBuf[0] << 8) | recvBuf[1];
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 /** Read multiple words from a 16-bit device register.
@@ -234,52 +242,48 @@ int8_t I2Cdev::readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data) {
  */
 int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
-	uint8_t response = bcm2835_i2c_write_read_rs(sendBuf, 1, recvBuf, length * 2);
+	bool response = writeRead(devAddr, (const uint8_t*)sendBuf, 1, (uint8_t*)recvBuf, length * 2);
 	uint8_t i;
 	for (i = 0; i < length; i++) {
 		data[i] = (recvBuf[i * 2] << 8) | recvBuf[i * 2 + 1];
 	}
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 bool I2Cdev::writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data) {
 	
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
 	sendBuf[1] = (uint8_t)(data >> 8); //MSByte
 	sendBuf[2] = (uint8_t)(data >> 0); //LSByte
-	uint8_t response = bcm2835_i2c_write(sendBuf, 3);
+	bool response = write(devAddr, (const uint8_t*)sendBuf, 3);
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
 	uint8_t i;
 	for (i = 0; i < length; i++) {
 		sendBuf[i + 1] = data[i];
 	}
-	uint8_t response = bcm2835_i2c_write(sendBuf, 1 + length);
+	bool response = write(devAddr, (const uint8_t*)sendBuf, 1 + length);
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
 
 bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data) {
 	enable(false);
-	bcm2835_i2c_setSlaveAddress(devAddr);
 	sendBuf[0] = regAddr;
 	uint8_t i;
 	for (i = 0; i < length; i++) {
 		sendBuf[1 + 2*i] = (uint8_t)(data[i] >> 8); //MSByte
 		sendBuf[2 + 2*i] = (uint8_t)(data[i] >> 0); //LSByte
 	}
-	uint8_t response = bcm2835_i2c_write(sendBuf, 1 + 2*length);
+	bool response = write(devAddr, (const uint8_t*)sendBuf, 1 + 2*length);
 	enable(true);
-	return response == BCM2835_I2C_REASON_OK ;
+	return response;
 }
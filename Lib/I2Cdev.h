@@ -30,7 +30,8 @@ THE SOFTWARE.
 #ifndef _I2CDEV_H_
 #define _I2CDEV_H_
 
-#include <bcm2835.h>
+#include "BusConfig.h"
+#include "I2CSink.h"
 #include <math.h> // required for BMP180
 #include <stdlib.h> // required for MPU6060
 #include <string.h> // required for MPU6060
@@ -67,6 +68,14 @@ class I2Cdev {
         static bool writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data);
         static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
+
+        // Mirrors every transaction into the sink, e.g. an I2CTraceRecorder
+        static void setTrace(I2CSink* trace);
+ private:
+        static I2CSink* _trace;
+
+        static bool writeRead(uint8_t devAddr, const uint8_t* tx, uint32_t txLength, uint8_t* rx, uint32_t rxLength);
+        static bool write(uint8_t devAddr, const uint8_t* data, uint32_t length);
 };
 
 #endif /* _I2CDEV_H_ */
@@ -1,4 +1,5 @@
 #include "MAG3110.h"
+#include "def.h"
 #include <math.h>
 #define CALIBRATION_TIMEOUT 5000 //timeout in milliseconds
 #define DEG_PER_RAD (180.0/3.14159265358979)
@@ -0,0 +1,127 @@
+#include "PixelConvert.h"
+#include <string.h>
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define PIXEL_CONVERT_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXEL_CONVERT_SSE2
+#endif
+
+static inline void putRGB(uint8_t* out, uint8_t r, uint8_t g, uint8_t b)
+{
+	out[0] = (r & 0xF8) | (g >> 5);
+	out[1] = ((g & 0x1C) << 3) | (b >> 3);
+}
+
+#if defined(PIXEL_CONVERT_NEON)
+// Byte planes in, interleaved high/low bytes out, 16 pixels at a time
+static inline void storeRGB(uint8_t* out, uint8x16_t r, uint8x16_t g, uint8x16_t b)
+{
+	uint8x16x2_t o;
+	o.val[0] = vorrq_u8(vandq_u8(r, vdupq_n_u8(0xF8)), vshrq_n_u8(g, 5));
+	o.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(g, vdupq_n_u8(0x1C)), 3), vshrq_n_u8(b, 3));
+	vst2q_u8(out, o);
+}
+#endif
+
+#if defined(PIXEL_CONVERT_SSE2)
+static inline __m128i swapBytes(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// Four 0xAARRGGBB pixels to RGB565 in the low half of each 32-bit lane,
+// sign extended so that _mm_packs_epi32 passes them through unsaturated
+static inline __m128i argbTo565(__m128i p)
+{
+	__m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800));
+	__m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+	__m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F));
+	__m128i c = _mm_or_si128(_mm_or_si128(r, g), b);
+	return _mm_srai_epi32(_mm_slli_epi32(c, 16), 16);
+}
+#endif
+
+static void convertRGB565(uint8_t* out, const uint16_t* in, uint32_t count)
+{
+	uint32_t i = 0;
+#if defined(PIXEL_CONVERT_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		vst1q_u8(out + i * 2, vrev16q_u8(vld1q_u8((const uint8_t*)(in + i))));
+	}
+#elif defined(PIXEL_CONVERT_SSE2)
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm_storeu_si128((__m128i*)(out + i * 2), swapBytes(_mm_loadu_si128((const __m128i*)(in + i))));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		uint16_t v = in[i];
+		out[i * 2] = v >> 8;
+		out[i * 2 + 1] = v & 0xFF;
+	}
+}
+
+static void convertRGB888(uint8_t* out, const uint8_t* in, uint32_t count)
+{
+	uint32_t i = 0;
+#if defined(PIXEL_CONVERT_NEON)
+	for (; i + 16 <= count; i += 16)
+	{
+		uint8x16x3_t v = vld3q_u8(in + i * 3);
+		storeRGB(out + i * 2, v.val[0], v.val[1], v.val[2]);
+	}
+#endif
+	// SSE2 has no cheap three byte deinterleave, the scalar loop does it there
+	for (; i < count; i++)
+	{
+		putRGB(out + i * 2, in[i * 3], in[i * 3 + 1], in[i * 3 + 2]);
+	}
+}
+
+static void convertARGB8888(uint8_t* out, const uint32_t* in, uint32_t count)
+{
+	uint32_t i = 0;
+#if defined(PIXEL_CONVERT_NEON)
+	for (; i + 16 <= count; i += 16)
+	{
+		// Little endian 0xAARRGGBB lies in memory as B, G, R, A
+		uint8x16x4_t v = vld4q_u8((const uint8_t*)(in + i));
+		storeRGB(out + i * 2, v.val[2], v.val[1], v.val[0]);
+	}
+#elif defined(PIXEL_CONVERT_SSE2)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = argbTo565(_mm_loadu_si128((const __m128i*)(in + i)));
+		__m128i hi = argbTo565(_mm_loadu_si128((const __m128i*)(in + i + 4)));
+		_mm_storeu_si128((__m128i*)(out + i * 2), swapBytes(_mm_packs_epi32(lo, hi)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		uint32_t p = in[i];
+		putRGB(out + i * 2, (p >> 16) & 0xFF, (p >> 8) & 0xFF, p & 0xFF);
+	}
+}
+
+void convertPixels(uint8_t* out, const void* in, uint32_t count, PixelFormatEnum format)
+{
+	switch (format)
+	{
+	case PIXEL_RGB565:
+		convertRGB565(out, (const uint16_t*)in, count);
+		break;
+	case PIXEL_RGB888:
+		convertRGB888(out, (const uint8_t*)in, count);
+		break;
+	case PIXEL_ARGB8888:
+		convertARGB8888(out, (const uint32_t*)in, count);
+		break;
+	case PIXEL_RGB565_BUS:
+		if (out != in) memcpy(out, in, count * 2);
+		break;
+	}
+}
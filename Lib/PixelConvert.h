@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+// Layouts a pixel upload may come in
+typedef enum
+{
+	PIXEL_RGB565,       ///< Native endian uint16_t
+	PIXEL_RGB888,       ///< Three bytes per pixel, red first
+	PIXEL_ARGB8888,     ///< Native endian uint32_t 0xAARRGGBB, alpha ignored
+	PIXEL_RGB565_BUS    ///< RGB565 already high byte first, sent as is
+} PixelFormatEnum;
+
+inline uint32_t pixelFormatSize(PixelFormatEnum format)
+{
+	return format == PIXEL_ARGB8888 ? 4 : format == PIXEL_RGB888 ? 3 : 2;
+}
+
+// Converts count pixels to RGB565, high byte first as the bus expects. out
+// may be the same buffer as in, every block is read before it is written.
+void convertPixels(uint8_t* out, const void* in, uint32_t count, PixelFormatEnum format);
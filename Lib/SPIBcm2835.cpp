@@ -0,0 +1,104 @@
+#include "SPIBcm2835.h"
+#include <string.h>
+#include <bcm2835.h>
+
+SPIBcm2835Backend::SPIBcm2835Backend()
+{
+	_csPin = RPI_GPIO_P1_24;
+	_submissions = 0;
+}
+
+bool SPIBcm2835Backend::open(uint8_t channel, SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder)
+{
+	_csPin = channel == 0 ? RPI_GPIO_P1_24 : RPI_GPIO_P1_26;
+	if (!bcm2835_init()) return false;
+	if (!bcm2835_spi_begin()) return false;
+	uint8_t spiMode = BCM2835_SPI_MODE0;
+	switch (mode)
+	{
+	case MODE_0:
+		{
+			spiMode = BCM2835_SPI_MODE0;
+			break;
+		}
+	case MODE_1:
+		{
+			spiMode = BCM2835_SPI_MODE1;
+			break;
+		}
+	case MODE_2:
+		{
+			spiMode = BCM2835_SPI_MODE2;
+			break;
+		}
+	case MODE_3:
+		{
+			spiMode = BCM2835_SPI_MODE3;
+			break;
+		}
+	}
+	// The peripheral always shifts 8 bit words, 16 bit modes only pick the bit order
+	uint8_t bitsOrder = (bitsSizeOrder == SPI_8BIT_LSB || bitsSizeOrder == SPI_16BIT_LSB) ?
+		BCM2835_SPI_BIT_ORDER_LSBFIRST : BCM2835_SPI_BIT_ORDER_MSBFIRST;
+	bcm2835_spi_setBitOrder(bitsOrder);      // The default
+	bcm2835_spi_setDataMode(spiMode);                   // The default
+	bcm2835_spi_chipSelect(BCM2835_SPI_CS_NONE);                  // The default
+	bcm2835_gpio_fsel(_csPin, BCM2835_GPIO_FSEL_OUTP);
+	return true;
+}
+
+void SPIBcm2835Backend::close()
+{
+	bcm2835_spi_end();
+	bcm2835_close();
+}
+
+bool SPIBcm2835Backend::setClock(uint16_t clockDivider)
+{
+	bcm2835_spi_setClockDivider(clockDivider);
+	return true;
+}
+
+void SPIBcm2835Backend::select()
+{
+	bcm2835_gpio_write(_csPin, LOW);
+}
+
+void SPIBcm2835Backend::deselect()
+{
+	bcm2835_gpio_write(_csPin, HIGH);
+}
+
+int SPIBcm2835Backend::writev(const SPISpan* spans, uint32_t count, bool /* csChange */)
+{
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bcm2835_spi_writenb((const char*)spans[i].data, spans[i].size);
+		total += spans[i].size;
+	}
+	_submissions += count;
+	return total;
+}
+
+// bcm2835_spi_transfern works in place, so the reply overwrites a copy of tx
+int SPIBcm2835Backend::transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool /* csChange */)
+{
+	if (rx != tx) memcpy(rx, tx, size);
+	bcm2835_spi_transfern((char*)rx, size);
+	_submissions++;
+	return size;
+}
+
+// One writenb per frame with the CS pin toggled in between
+int SPIBcm2835Backend::submit(const SPITransaction& transaction)
+{
+	for (uint32_t i = 0; i < transaction.frames(); i++)
+	{
+		bcm2835_gpio_write(_csPin, LOW);
+		bcm2835_spi_writenb((const char*)transaction.frameData(i), transaction.frameSize(i));
+		bcm2835_gpio_write(_csPin, HIGH);
+	}
+	_submissions += transaction.frames();
+	return transaction.size();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "SPITypes.h"
+#include <atomic>
+
+// SPI0 through the bcm2835 library. CS is driven as a plain GPIO so that a
+// frame may span any number of writes.
+class SPIBcm2835Backend
+{
+public:
+	SPIBcm2835Backend();
+	bool open(uint8_t channel, SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder);
+	void close();
+	bool setClock(uint16_t clockDivider);
+	void select();
+	void deselect();
+	int writev(const SPISpan* spans, uint32_t count, bool csChange);
+	int transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool csChange);
+	int submit(const SPITransaction& transaction);
+	uint32_t submissions() const { return _submissions; }
+	void resetSubmissions() { _submissions = 0; }
+private:
+	uint8_t _csPin;
+	std::atomic<uint32_t> _submissions;   ///< Also counted by the async I/O thread
+};
@@ -0,0 +1,75 @@
+#include "SPISim.h"
+#include <string.h>
+
+SPISink* SPISimBackend::_sinks[SPI_SIM_CHANNELS] = { NULL, NULL };
+
+SPISimBackend::SPISimBackend()
+{
+	_channel = 0;
+	_submissions = 0;
+}
+
+// Binds a sink to the channel, before or after the device has been opened
+void SPISimBackend::attach(uint8_t channel, SPISink* sink)
+{
+	if (channel < SPI_SIM_CHANNELS) _sinks[channel] = sink;
+}
+
+bool SPISimBackend::open(uint8_t channel, SPIDataModeEnum /* mode */, SPIBitSizeOrderEnum /* bitsSizeOrder */)
+{
+	if (channel >= SPI_SIM_CHANNELS) return false;
+	_channel = channel;
+	return true;
+}
+
+void SPISimBackend::close()
+{
+}
+
+bool SPISimBackend::setClock(uint16_t clockDivider)
+{
+	if (sink()) sink()->setClock(clockDivider);
+	return true;
+}
+
+void SPISimBackend::select()
+{
+	if (sink()) sink()->select();
+}
+
+void SPISimBackend::deselect()
+{
+	if (sink()) sink()->deselect();
+}
+
+int SPISimBackend::writev(const SPISpan* spans, uint32_t count, bool /* csChange */)
+{
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (sink()) sink()->transfer(spans[i].data, NULL, spans[i].size);
+		total += spans[i].size;
+	}
+	_submissions += count;
+	return total;
+}
+
+int SPISimBackend::transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool /* csChange */)
+{
+	memset(rx, 0, size);
+	if (sink()) sink()->transfer(tx, rx, size);
+	_submissions++;
+	return size;
+}
+
+int SPISimBackend::submit(const SPITransaction& transaction)
+{
+	for (uint32_t i = 0; i < transaction.frames(); i++)
+	{
+		select();
+		if (sink()) sink()->transfer(transaction.frameData(i), NULL, transaction.frameSize(i));
+		deselect();
+	}
+	_submissions++;
+	return transaction.size();
+}
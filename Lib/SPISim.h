@@ -0,0 +1,32 @@
+#pragma once
+#include "SPITypes.h"
+#include <atomic>
+#include "SPISink.h"
+
+#define SPI_SIM_CHANNELS	2
+
+// Bus simulation: every event is handed to the SPISink attached to the channel,
+// e.g. a device model or an SPITraceRecorder. Reads return zeroes unless the
+// sink answers them.
+class SPISimBackend
+{
+public:
+	SPISimBackend();
+	static void attach(uint8_t channel, SPISink* sink);
+	bool open(uint8_t channel, SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder);
+	void close();
+	bool setClock(uint16_t clockDivider);
+	void select();
+	void deselect();
+	int writev(const SPISpan* spans, uint32_t count, bool csChange);
+	int transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool csChange);
+	int submit(const SPITransaction& transaction);
+	uint32_t submissions() const { return _submissions; }
+	void resetSubmissions() { _submissions = 0; }
+private:
+	static SPISink* _sinks[SPI_SIM_CHANNELS];
+	uint8_t _channel;
+	std::atomic<uint32_t> _submissions;   ///< Also counted by the async I/O thread
+
+	SPISink* sink() const { return _sinks[_channel]; }
+};
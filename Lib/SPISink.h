@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// Receiver of SPI bus events as seen on the wire: chip select edges, clock
+// changes and transfers. rx is NULL for write-only transfers, tx is NULL when a
+// replayed trace carries no payload.
+class SPISink
+{
+public:
+	virtual ~SPISink() {}
+	virtual void select() = 0;
+	virtual void deselect() = 0;
+	virtual void transfer(const uint8_t* tx, uint8_t* rx, uint32_t size) = 0;
+	virtual void setClock(uint16_t /* clockDivider */) {}
+};
@@ -0,0 +1,209 @@
+#include "SPISpidev.h"
+#include <fcntl.h>				//Needed for SPI port
+#include <sys/ioctl.h>			//Needed for SPI port
+#include <unistd.h>				//Needed for SPI port
+#include <stdio.h>
+#include <string.h>
+
+SPISpidevBackend::SPISpidevBackend()
+{
+	_fileHandle = -1;
+	_bufSize = SPI_DEFAULT_BUFSIZ;
+	_frameOpen = false;
+	_csHeld = false;
+	_segmentCount = 0;
+	_segmentBytes = 0;
+	_stageUsed = 0;
+	_submissions = 0;
+}
+
+bool SPISpidevBackend::open(uint8_t channel, SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder)
+{
+	int status_value = -1;
+	uint8_t spiMode = SPI_MODE_0;
+	switch (mode)
+	{
+	case MODE_0:
+		{
+			spiMode = SPI_MODE_0;
+			break;
+		}
+	case MODE_1:
+		{
+			spiMode = SPI_MODE_1;
+			break;
+		}
+	case MODE_2:
+		{
+			spiMode = SPI_MODE_2;
+			break;
+		}
+	case MODE_3:
+		{
+			spiMode = SPI_MODE_3;
+			break;
+		}
+	}
+	_fileHandle = ::open(channel == 0 ? "/dev/spidev0.0" : "/dev/spidev0.1", O_RDWR);
+	if (_fileHandle < 0) return false;
+	detectBufSize();
+
+	uint8_t bitsPerWord = (bitsSizeOrder == SPI_16BIT_MSB || bitsSizeOrder == SPI_16BIT_LSB) ? 16 : 8;
+	uint8_t bitsOrder = (bitsSizeOrder == SPI_8BIT_LSB || bitsSizeOrder == SPI_16BIT_LSB) ? 1 : 0;
+	
+	status_value = ioctl(_fileHandle, SPI_IOC_WR_MODE, &spiMode);
+	if (status_value < 0) return false;
+	
+	status_value = ioctl(_fileHandle, SPI_IOC_RD_MODE, &spiMode);
+	if (status_value < 0) return false;
+	
+	status_value = ioctl(_fileHandle, SPI_IOC_WR_BITS_PER_WORD, &bitsPerWord);
+	if (status_value < 0) return false;
+	
+	status_value = ioctl(_fileHandle, SPI_IOC_RD_BITS_PER_WORD, &bitsPerWord);
+	if (status_value < 0) return false;
+
+	status_value = ioctl(_fileHandle, SPI_IOC_WR_LSB_FIRST, &bitsOrder);
+	if (status_value < 0) return false;
+	return true;
+}
+
+void SPISpidevBackend::close()
+{
+	flushSegments();
+	::close(_fileHandle);
+	_fileHandle = -1;
+}
+
+bool SPISpidevBackend::setClock(uint16_t clockDivider)
+{
+	uint32_t spi_speed = 250000000 / (clockDivider == CLOCK_DIVIDER_65536 ? 65536 : clockDivider);
+	int status_value = ioctl(_fileHandle, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed);
+	if (status_value < 0) return false;
+	status_value = ioctl(_fileHandle, SPI_IOC_RD_MAX_SPEED_HZ, &spi_speed);
+	if (status_value < 0) return false;
+	return true;
+}
+
+void SPISpidevBackend::select()
+{
+	_frameOpen = true;
+}
+
+// A read inside the frame has already flushed with CS held, so when nothing
+// is queued any more an empty segment releases it
+void SPISpidevBackend::deselect()
+{
+	_frameOpen = false;
+	if (_segmentCount == 0 && _csHeld)
+	{
+		struct spi_ioc_transfer& seg = _segments[_segmentCount++];
+		memset(&seg, 0, sizeof(seg));
+	}
+	endFrame();
+	flushSegments();
+}
+
+int SPISpidevBackend::writev(const SPISpan* spans, uint32_t count, bool csChange)
+{
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		queueSegment(stage(spans[i].data, spans[i].size), NULL, spans[i].size);
+		total += spans[i].size;
+	}
+	if (!_frameOpen)
+	{
+		if (!csChange) endFrame();
+		if (flushSegments() < 0) return -1;
+	}
+	return total;
+}
+
+// The reply is needed right away, so the queue is flushed even inside a frame
+int SPISpidevBackend::transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool csChange)
+{
+	queueSegment(stage(tx, size), rx, size);
+	if (!_frameOpen && !csChange) endFrame();
+	if (flushSegments() < 0) return -1;
+	return size;
+}
+
+// The whole list goes out in a single SPI_IOC_MESSAGE as long as it fits
+int SPISpidevBackend::submit(const SPITransaction& transaction)
+{
+	for (uint32_t i = 0; i < transaction.frames(); i++)
+	{
+		queueSegment(transaction.frameData(i), NULL, transaction.frameSize(i));
+		endFrame();
+	}
+	return flushSegments();
+}
+
+// spidev rejects messages larger than its bufsiz module parameter (4096 by default,
+// raise it with spidev.bufsiz= on the kernel command line to send a frame per ioctl)
+void SPISpidevBackend::detectBufSize()
+{
+	_bufSize = SPI_DEFAULT_BUFSIZ;
+	FILE* f = fopen("/sys/module/spidev/parameters/bufsiz", "r");
+	if (f == NULL) return;
+	unsigned long bufsiz;
+	if (fscanf(f, "%lu", &bufsiz) == 1 && bufsiz > 0) _bufSize = bufsiz;
+	fclose(f);
+}
+
+// Copies small writes aside so that the caller's buffer may go away before the
+// segment is flushed. Makes room for the segment first, queueSegment relies on it.
+const uint8_t* SPISpidevBackend::stage(const uint8_t* data, uint32_t dataSize)
+{
+	if (dataSize > SPI_STAGE_SIZE || dataSize > _bufSize) return data;
+	if (_stageUsed + dataSize > SPI_STAGE_SIZE || _segmentCount == SPI_IOC_MAX_SEGMENTS ||
+		_segmentBytes + dataSize > _bufSize) flushSegments();
+	uint8_t* r = _stage + _stageUsed;
+	memcpy(r, data, dataSize);
+	_stageUsed += dataSize;
+	return r;
+}
+
+void SPISpidevBackend::queueSegment(const uint8_t* tx, uint8_t* rx, uint32_t len)
+{
+	while (len > 0)
+	{
+		if (_segmentCount == SPI_IOC_MAX_SEGMENTS || _segmentBytes >= _bufSize) flushSegments();
+		uint32_t chunk = _bufSize - _segmentBytes;
+		if (chunk > len) chunk = len;
+		struct spi_ioc_transfer& seg = _segments[_segmentCount++];
+		memset(&seg, 0, sizeof(seg));
+		seg.tx_buf = (unsigned long)tx;
+		seg.rx_buf = (unsigned long)rx;
+		seg.len = chunk;
+		_segmentBytes += chunk;
+		tx += chunk;
+		if (rx) rx += chunk;
+		len -= chunk;
+	}
+}
+
+// Marks the last queued segment as the end of a chip select frame
+void SPISpidevBackend::endFrame()
+{
+	if (_segmentCount > 0) _segments[_segmentCount - 1].cs_change = 1;
+}
+
+// cs_change toggles CS after a segment, except on the last segment of a message
+// where it keeps CS asserted. Flip it there, so that a completed frame releases
+// CS and a frame split over several ioctls stays selected.
+int SPISpidevBackend::flushSegments()
+{
+	if (_segmentCount == 0) return 0;
+	struct spi_ioc_transfer& last = _segments[_segmentCount - 1];
+	last.cs_change = !last.cs_change;
+	_csHeld = last.cs_change;
+	int retVal = ioctl(_fileHandle, SPI_IOC_MESSAGE(_segmentCount), _segments);
+	if (retVal < 0) perror("Error - Problem transmitting spi data..ioctl");
+	_submissions++;
+	_segmentCount = 0;
+	_segmentBytes = 0;
+	_stageUsed = 0;
+	return retVal;
+}
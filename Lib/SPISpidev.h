@@ -0,0 +1,45 @@
+#pragma once
+#include "SPITypes.h"
+#include <atomic>
+#include <linux/spi/spidev.h>
+
+#define SPI_IOC_MAX_SEGMENTS	511     // SPI_IOC_MESSAGE(N) encodes N * 32 bytes in a 14 bit size field
+#define SPI_DEFAULT_BUFSIZ		4096    // spidev default, see /sys/module/spidev/parameters/bufsiz
+#define SPI_STAGE_SIZE			256
+
+// /dev/spidevX.Y. Writes are queued as spi_ioc_transfer segments and pushed in
+// as few SPI_IOC_MESSAGE calls as the driver accepts. Buffers written between
+// select() and deselect() may be queued by reference and must stay untouched
+// until deselect().
+class SPISpidevBackend
+{
+public:
+	SPISpidevBackend();
+	bool open(uint8_t channel, SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder);
+	void close();
+	bool setClock(uint16_t clockDivider);
+	void select();
+	void deselect();
+	int writev(const SPISpan* spans, uint32_t count, bool csChange);
+	int transfer(const uint8_t* tx, uint8_t* rx, uint32_t size, bool csChange);
+	int submit(const SPITransaction& transaction);
+	uint32_t submissions() const { return _submissions; }
+	void resetSubmissions() { _submissions = 0; }
+private:
+	int _fileHandle;
+	uint32_t _bufSize;
+	bool _frameOpen;
+	bool _csHeld;                   ///< The last ioctl left CS asserted
+	struct spi_ioc_transfer _segments[SPI_IOC_MAX_SEGMENTS];
+	uint32_t _segmentCount;
+	uint32_t _segmentBytes;
+	uint8_t _stage[SPI_STAGE_SIZE];
+	uint32_t _stageUsed;
+	std::atomic<uint32_t> _submissions;   ///< Also counted by the async I/O thread
+
+	void detectBufSize();
+	const uint8_t* stage(const uint8_t* data, uint32_t dataSize);
+	void queueSegment(const uint8_t* tx, uint8_t* rx, uint32_t len);
+	void endFrame();
+	int flushSegments();
+};
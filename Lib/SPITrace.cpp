@@ -0,0 +1,223 @@
+#include "SPITrace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SPI_TRACE_FILE_BUFFER	(64 * 1024)
+
+uint32_t spiTraceDigest(const uint8_t* data, uint32_t size)
+{
+	uint32_t hash = 2166136261u; // FNV-1a
+	for (uint32_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+uint64_t spiTraceNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+///////////////// Recorder
+
+SPITraceRecorder::SPITraceRecorder()
+{
+	_file = NULL;
+	_mode = SPI_TRACE_DIGEST;
+	_startNs = 0;
+	_clockDivider = 0;
+	_selected = false;
+}
+
+SPITraceRecorder::~SPITraceRecorder()
+{
+	close();
+}
+
+bool SPITraceRecorder::open(const char* path, SPITraceModeEnum mode)
+{
+	close();
+	_file = fopen(path, "wb");
+	if (_file == NULL) return false;
+	setvbuf(_file, NULL, _IOFBF, SPI_TRACE_FILE_BUFFER);
+	_mode = mode;
+	_startNs = spiTraceNow();
+	_selected = false;
+	SPITraceHeader header = { SPI_TRACE_MAGIC, SPI_TRACE_VERSION, (uint16_t)mode };
+	return fwrite(&header, sizeof(header), 1, _file) == 1;
+}
+
+void SPITraceRecorder::close()
+{
+	if (_file == NULL) return;
+	fclose(_file);
+	_file = NULL;
+}
+
+void SPITraceRecorder::writeRecord(uint8_t type, uint8_t flags, uint32_t size)
+{
+	SPITraceRecord record;
+	record.timestampNs = spiTraceNow() - _startNs;
+	record.type = type;
+	record.flags = flags | (_selected ? SPI_TRACE_FLAG_CS : 0);
+	record.clockDivider = _clockDivider;
+	record.size = size;
+	fwrite(&record, sizeof(record), 1, _file);
+}
+
+void SPITraceRecorder::select()
+{
+	if (_file == NULL) return;
+	_selected = true;
+	writeRecord(SPI_TRACE_SELECT, 0, 0);
+}
+
+void SPITraceRecorder::deselect()
+{
+	if (_file == NULL) return;
+	writeRecord(SPI_TRACE_DESELECT, 0, 0);
+	_selected = false;
+}
+
+void SPITraceRecorder::transfer(const uint8_t* tx, uint8_t* rx, uint32_t size)
+{
+	if (_file == NULL) return;
+	uint8_t flags = 0;
+	if (_mode == SPI_TRACE_FULL) flags |= SPI_TRACE_FLAG_PAYLOAD | (rx ? SPI_TRACE_FLAG_RX : 0);
+	writeRecord(rx ? SPI_TRACE_TRANSFER : SPI_TRACE_WRITE, flags, size);
+	uint32_t digest = spiTraceDigest(tx, size);
+	fwrite(&digest, sizeof(digest), 1, _file);
+	if (flags & SPI_TRACE_FLAG_PAYLOAD) fwrite(tx, 1, size, _file);
+	if (flags & SPI_TRACE_FLAG_RX) fwrite(rx, 1, size, _file);
+}
+
+void SPITraceRecorder::setClock(uint16_t clockDivider)
+{
+	_clockDivider = clockDivider;
+	if (_file == NULL) return;
+	writeRecord(SPI_TRACE_CLOCK, 0, 0);
+}
+
+///////////////// Replayer
+
+SPITraceReplayer::SPITraceReplayer()
+{
+	_file = NULL;
+	_mode = SPI_TRACE_DIGEST;
+	_payload = NULL;
+	_payloadCapacity = 0;
+	_payloadSize = 0;
+	_digest = 0;
+	_hasPayload = false;
+	_hasRx = false;
+}
+
+SPITraceReplayer::~SPITraceReplayer()
+{
+	close();
+	free(_payload);
+}
+
+bool SPITraceReplayer::open(const char* path)
+{
+	close();
+	_file = fopen(path, "rb");
+	if (_file == NULL) return false;
+	setvbuf(_file, NULL, _IOFBF, SPI_TRACE_FILE_BUFFER);
+	SPITraceHeader header;
+	if (fread(&header, sizeof(header), 1, _file) != 1 ||
+		header.magic != SPI_TRACE_MAGIC || header.version != SPI_TRACE_VERSION)
+	{
+		close();
+		return false;
+	}
+	_mode = (SPITraceModeEnum)header.mode;
+	return true;
+}
+
+void SPITraceReplayer::close()
+{
+	if (_file == NULL) return;
+	fclose(_file);
+	_file = NULL;
+}
+
+bool SPITraceReplayer::next(SPITraceRecord& record)
+{
+	if (_file == NULL || fread(&record, sizeof(record), 1, _file) != 1) return false;
+	_hasPayload = (record.flags & SPI_TRACE_FLAG_PAYLOAD) != 0;
+	_hasRx = (record.flags & SPI_TRACE_FLAG_RX) != 0;
+	_payloadSize = record.size;
+	_digest = 0;
+	if (record.type != SPI_TRACE_WRITE && record.type != SPI_TRACE_TRANSFER) return true;
+	if (fread(&_digest, sizeof(_digest), 1, _file) != 1) return false;
+
+	// Laid out as tx, recorded rx and a scratch rx area used by replay()
+	uint32_t need = record.size * 3;
+	if (need > _payloadCapacity)
+	{
+		uint8_t* payload = (uint8_t*)realloc(_payload, need);
+		if (payload == NULL) return false;
+		_payload = payload;
+		_payloadCapacity = need;
+	}
+	uint32_t stored = (_hasPayload ? record.size : 0) + (_hasRx ? record.size : 0);
+	return fread(_payload, 1, stored, _file) == stored;
+}
+
+bool SPITraceReplayer::replay(SPISink* sink, bool realtime, SPITraceReplayStats* stats)
+{
+	SPITraceReplayStats s;
+	memset(&s, 0, sizeof(s));
+	SPITraceRecord record;
+	uint64_t startNs = spiTraceNow();
+	while (next(record))
+	{
+		if (realtime)
+		{
+			uint64_t elapsed = spiTraceNow() - startNs;
+			if (record.timestampNs > elapsed)
+			{
+				uint64_t wait = record.timestampNs - elapsed;
+				struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+				nanosleep(&ts, NULL);
+			}
+		}
+		s.records++;
+		s.recordedNs = record.timestampNs;
+		switch (record.type)
+		{
+		case SPI_TRACE_SELECT:
+			sink->select();
+			break;
+		case SPI_TRACE_DESELECT:
+			sink->deselect();
+			break;
+		case SPI_TRACE_CLOCK:
+			sink->setClock(record.clockDivider);
+			break;
+		case SPI_TRACE_WRITE:
+			sink->transfer(payload(), NULL, record.size);
+			s.transfers++;
+			s.bytes += record.size;
+			break;
+		case SPI_TRACE_TRANSFER:
+			{
+				uint8_t* rx = _payload + record.size * 2;
+				sink->transfer(payload(), rx, record.size);
+				if (_hasRx && memcmp(rx, rxPayload(), record.size) != 0) s.rxMismatches++;
+				s.transfers++;
+				s.bytes += record.size;
+				break;
+			}
+		}
+	}
+	s.elapsedNs = spiTraceNow() - startNs;
+	if (stats) *stats = s;
+	return s.records > 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "SPISink.h"
+#include <stdio.h>
+
+#define SPI_TRACE_MAGIC		0x54495053  // "SPIT"
+#define SPI_TRACE_VERSION	1
+
+enum SPITraceTypeEnum
+{
+	SPI_TRACE_SELECT   = 1,  ///< CS asserted
+	SPI_TRACE_DESELECT = 2,  ///< CS released
+	SPI_TRACE_WRITE    = 3,  ///< Transmit only transfer
+	SPI_TRACE_TRANSFER = 4,  ///< Full duplex transfer
+	SPI_TRACE_CLOCK    = 5   ///< Clock divider change
+};
+
+enum SPITraceModeEnum
+{
+	SPI_TRACE_DIGEST,        ///< Record FNV-1a digests of the payloads only
+	SPI_TRACE_FULL           ///< Record complete tx and rx payloads
+};
+
+#define SPI_TRACE_FLAG_PAYLOAD	0x01  // tx payload follows the record
+#define SPI_TRACE_FLAG_RX		0x02  // rx payload follows the tx payload
+#define SPI_TRACE_FLAG_CS		0x04  // CS was asserted during the event
+
+#pragma pack(push, 1)
+struct SPITraceHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t mode;
+};
+
+// Fixed part of every record. Transfers are followed by their digest and,
+// in SPI_TRACE_FULL mode, by the payload bytes.
+struct SPITraceRecord
+{
+	uint64_t timestampNs;    ///< Nanoseconds since the recorder was opened
+	uint8_t type;            ///< SPITraceTypeEnum
+	uint8_t flags;           ///< SPI_TRACE_FLAG_*
+	uint16_t clockDivider;   ///< Divider in effect
+	uint32_t size;           ///< Transfer size in bytes
+};
+#pragma pack(pop)
+
+struct SPITraceReplayStats
+{
+	uint32_t records;
+	uint32_t transfers;
+	uint32_t bytes;
+	uint32_t rxMismatches;   ///< Reads where the sink answered differently than the recorded device
+	uint64_t recordedNs;     ///< Span of the recorded trace
+	uint64_t elapsedNs;      ///< Wall time spent replaying
+};
+
+uint32_t spiTraceDigest(const uint8_t* data, uint32_t size);
+uint64_t spiTraceNow();
+
+// Writes every bus event it receives to a binary log. Attach it to an SPIdev
+// with SPIdev::setTrace.
+class SPITraceRecorder : public SPISink
+{
+public:
+	SPITraceRecorder();
+	~SPITraceRecorder();
+	bool open(const char* path, SPITraceModeEnum mode);
+	void close();
+	bool isOpen() const { return _file != NULL; }
+
+	virtual void select();
+	virtual void deselect();
+	virtual void transfer(const uint8_t* tx, uint8_t* rx, uint32_t size);
+	virtual void setClock(uint16_t clockDivider);
+private:
+	FILE* _file;
+	SPITraceModeEnum _mode;
+	uint64_t _startNs;
+	uint16_t _clockDivider;
+	bool _selected;
+
+	void writeRecord(uint8_t type, uint8_t flags, uint32_t size);
+};
+
+// Reads a trace back and feeds it to a sink, either paced like the original
+// recording or as fast as possible
+class SPITraceReplayer
+{
+public:
+	SPITraceReplayer();
+	~SPITraceReplayer();
+	bool open(const char* path);
+	void close();
+	SPITraceModeEnum mode() const { return _mode; }
+	bool next(SPITraceRecord& record);
+	uint32_t digest() const { return _digest; }
+	const uint8_t* payload() const { return _hasPayload ? _payload : NULL; }
+	const uint8_t* rxPayload() const { return _hasRx ? _payload + _payloadSize : NULL; }
+	bool replay(SPISink* sink, bool realtime, SPITraceReplayStats* stats = NULL);
+private:
+	FILE* _file;
+	SPITraceModeEnum _mode;
+	uint8_t* _payload;
+	uint32_t _payloadCapacity;
+	uint32_t _payloadSize;
+	uint32_t _digest;
+	bool _hasPayload;
+	bool _hasRx;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+
+typedef enum
+{
+	MODE_0 = 0x00, //CPOL:0, CPHA:0
+	MODE_1 = 0x02, //CPOL:0, CPHA:1
+	MODE_2 = 0x04, //CPOL:1, CPHA:0
+	MODE_3 = 0x08, //CPOL:1, CPHA:1
+} SPIDataModeEnum;
+
+typedef enum
+{
+	SPI_8BIT_MSB  = 0x00,
+	SPI_16BIT_MSB = 0x02,
+	SPI_8BIT_LSB  = 0x04,
+	SPI_16BIT_LSB = 0x08
+} SPIBitSizeOrderEnum;
+
+typedef enum
+{
+	CLOCK_DIVIDER_65536 = 0,       ///< 65536 = 256us = 4kHz
+	CLOCK_DIVIDER_32768 = 32768,   ///< 32768 = 126us = 8kHz
+	CLOCK_DIVIDER_16384 = 16384,   ///< 16384 = 64us = 15.625kHz
+	CLOCK_DIVIDER_8192  = 8192,    ///< 8192 = 32us = 31.25kHz
+	CLOCK_DIVIDER_4096  = 4096,    ///< 4096 = 16us = 62.5kHz
+	CLOCK_DIVIDER_2048  = 2048,    ///< 2048 = 8us = 125kHz
+	CLOCK_DIVIDER_1024  = 1024,    ///< 1024 = 4us = 250kHz
+	CLOCK_DIVIDER_512   = 512,     ///< 512 = 2us = 500kHz
+	CLOCK_DIVIDER_256   = 256,     ///< 256 = 1us = 1MHz
+	CLOCK_DIVIDER_128   = 128,     ///< 128 = 500ns = = 2MHz
+	CLOCK_DIVIDER_64    = 64,      ///< 64 = 250ns = 4MHz
+	CLOCK_DIVIDER_32    = 32,      ///< 32 = 125ns = 8MHz
+	CLOCK_DIVIDER_16    = 16,      ///< 16 = 50ns = 20MHz
+	CLOCK_DIVIDER_8     = 8,       ///< 8 = 25ns = 40MHz
+	CLOCK_DIVIDER_4     = 4,       ///< 4 = 12.5ns 80MHz
+	CLOCK_DIVIDER_2     = 2,       ///< 2 = 6.25ns = 160MHz
+	CLOCK_DIVIDER_1     = 1,       ///< 0 = 256us = 4kHz
+} SPIClockDividerEnum;
+
+// Named bus clock settings, so that each kind of access runs at the fastest
+// divider the peripheral tolerates for it
+typedef enum
+{
+	SPI_PROFILE_REG_READ,
+	SPI_PROFILE_REG_WRITE,
+	SPI_PROFILE_BULK_WRITE,
+	SPI_PROFILE_COUNT
+} SPIClockProfileEnum;
+
+#define SPI_TRANSACTION_BUFFER_SIZE	512
+#define SPI_TRANSACTION_MAX_FRAMES	256
+
+// Bus traffic counters
+struct SPIStats
+{
+	uint32_t bytes;         ///< Bytes clocked out on the bus
+	uint32_t csCycles;      ///< Chip select assert/release cycles
+	uint32_t submissions;   ///< Calls into the SPI driver (bcm2835_spi_* / ioctl)
+};
+
+// Stages a list of chip select framed transfers so that SPIdev can
+// push them to the bus in as few driver submissions as possible
+class SPITransaction
+{
+public:
+	SPITransaction();
+	void clear();
+	bool frame(const uint8_t* data, uint32_t dataSize);
+	bool frame(uint8_t b0, uint8_t b1);
+	bool empty() const { return _frameCount == 0; }
+	bool full(uint32_t dataSize) const;
+	uint32_t size() const { return _size; }
+	uint32_t frames() const { return _frameCount; }
+	const uint8_t* frameData(uint32_t frame) const;
+	uint32_t frameSize(uint32_t frame) const;
+private:
+	uint8_t _buffer[SPI_TRANSACTION_BUFFER_SIZE];
+	uint16_t _frameEnd[SPI_TRANSACTION_MAX_FRAMES];
+	uint32_t _size;
+	uint32_t _frameCount;
+};
+
+// One piece of a gathered write, see SPIdev::writev
+struct SPISpan
+{
+	const uint8_t* data;
+	uint32_t size;
+};
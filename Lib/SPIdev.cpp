@@ -1,240 +1,364 @@
 #include "SPIdev.h"
+#include <string.h>
 
-#ifdef USE_SPI_DEVICE
-#include <fcntl.h>				//Needed for SPI port
-#include <sys/ioctl.h>			//Needed for SPI port
-#include <linux/spi/spidev.h>	//Needed for SPI port
-#include <unistd.h>				//Needed for SPI port
-#include <stdio.h>
-#include <stdlib.h>
-#include <string>
-#include <iostream>
-#include <unistd.h>
-#include <cstring>
-#elif defined(USE_SPI_BCM2835)
-#include <bcm2835.h>
-#endif
+SPITransaction::SPITransaction()
+{
+	clear();
+}
+
+void SPITransaction::clear()
+{
+	_size = 0;
+	_frameCount = 0;
+}
+
+bool SPITransaction::full(uint32_t dataSize) const
+{
+	return _frameCount >= SPI_TRANSACTION_MAX_FRAMES || _size + dataSize > SPI_TRANSACTION_BUFFER_SIZE;
+}
+
+bool SPITransaction::frame(const uint8_t* data, uint32_t dataSize)
+{
+	if (dataSize == 0 || full(dataSize)) return false;
+	memcpy(_buffer + _size, data, dataSize);
+	_size += dataSize;
+	_frameEnd[_frameCount++] = _size;
+	return true;
+}
+
+bool SPITransaction::frame(uint8_t b0, uint8_t b1)
+{
+	uint8_t data[2] = { b0, b1 };
+	return frame(data, 2);
+}
+
+const uint8_t* SPITransaction::frameData(uint32_t frame) const
+{
+	return _buffer + (frame == 0 ? 0 : _frameEnd[frame - 1]);
+}
+
+uint32_t SPITransaction::frameSize(uint32_t frame) const
+{
+	return _frameEnd[frame] - (frame == 0 ? 0 : _frameEnd[frame - 1]);
+}
 
 SPIdev::SPIdev(uint8_t channel)
 {
 	_spiChannel = channel;
-#ifdef USE_SPI_DEVICE
-	_spiCSPin = _spiChannel == 0 ? 10 : 11;
-#elif defined(USE_SPI_BCM2835)
-	_spiCSPin = _spiChannel == 0 ? RPI_GPIO_P1_24 : RPI_GPIO_P1_26;
-#endif
+	_spi_clockDivider = 0xFFFF;
+	_trace = NULL;
+	for (int i = 0; i < SPI_PROFILE_COUNT; i++)
+	{
+		_profileDivider[i] = CLOCK_DIVIDER_1024;
+	}
+	resetStats();
+	_asyncRunning = false;
+	_stagingSize = 0;
+	_stagingNext = 0;
+	_fenceSubmitted = 0;
+	_fenceCompleted = 0;
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
+	{
+		_staging[i] = NULL;
+		_stagingFence[i] = 0;
+		_stagingHeld[i] = false;
+	}
 }
 SPIdev::~SPIdev()
 {
+	stopAsync();
 }
 
+SPIStats SPIdev::stats() const
+{
+	SPIStats s;
+	s.bytes = _statBytes;
+	s.csCycles = _statCsCycles;
+	s.submissions = _backend.submissions();
+	return s;
+}
+
+void SPIdev::resetStats()
+{
+	_statBytes = 0;
+	_statCsCycles = 0;
+	_backend.resetSubmissions();
+}
+
+// Waits for queued asynchronous transfers first, so the clock never changes
+// under a transfer of the I/O thread and only one thread touches the divider
 bool SPIdev::setClockDiv(SPIClockDividerEnum clockDivider)
 {
+	waitIdle();
 	_spi_clockDivider = clockDivider;
-#ifdef USE_SPI_DEVICE
-	uint32_t spi_speed = 250000000 / clockDivider;
-	status_value = ioctl(_spiFileHandle, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed);
-	if (status_value < 0) return false;
-	status_value = ioctl(_spiFileHandle, SPI_IOC_RD_MAX_SPEED_HZ, &spi_speed);
-	if (status_value < 0) return false;
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_spi_setClockDivider(_spi_clockDivider); // The default
-#endif
-	return true;
+	if (_trace) _trace->setClock(clockDivider);
+	return _backend.setClock(clockDivider);
+}
+
+void SPIdev::setTrace(SPISink* trace)
+{
+	waitIdle();
+	_trace = trace;
+}
+
+void SPIdev::setProfileDivider(SPIClockProfileEnum profile, SPIClockDividerEnum clockDivider)
+{
+	_profileDivider[profile] = clockDivider;
+}
+
+// Only touches the hardware when the profile needs a different divider than the
+// one currently programmed, so alternating reads and writes cost nothing when
+// both profiles share a clock
+bool SPIdev::useProfile(SPIClockProfileEnum profile)
+{
+	waitIdle();
+	if (_profileDivider[profile] == _spi_clockDivider) return true;
+	return setClockDiv(_profileDivider[profile]);
 }
 
 bool SPIdev::initialize(SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder)
 {
-#ifdef USE_SPI_DEVICE
-	int status_value = -1;
-	switch (mode)
+	if (!_backend.open(_spiChannel, mode, bitsSizeOrder)) return false;
+	if (!setClockDiv(SPIClockDividerEnum::CLOCK_DIVIDER_1024)) return false;
+	return true;
+}
+
+void SPIdev::deinitialize()
+{
+	stopAsync();
+	_backend.close();
+}
+
+void SPIdev::begin()
+{
+	waitIdle();
+	_statCsCycles++;
+	if (_trace) _trace->select();
+	_backend.select();
+}
+
+void SPIdev::end()
+{
+	if (_trace) _trace->deselect();
+	_backend.deselect();
+}
+
+int SPIdev::write(const uint8_t* data, uint32_t dataSize, bool csChange)
+{
+	SPISpan span = { data, dataSize };
+	return writev(&span, 1, csChange);
+}
+
+// Gathers the spans into one transfer without copying them together, e.g. a
+// command prefix byte followed by an untouched pixel buffer
+int SPIdev::writev(const SPISpan* spans, uint32_t count, bool csChange)
+{
+	if (_trace)
 	{
-	case MODE_0:
-		{
-			_spi_mode = SPI_MODE_0;
-			break;
-		}
-	case MODE_1:
-		{
-			_spi_mode = SPI_MODE_1;
-			break;
-		}
-	case MODE_2:
-		{
-			_spi_mode = SPI_MODE_2;
-			break;
-		}
-	case MODE_3:
+		for (uint32_t i = 0; i < count; i++) _trace->transfer(spans[i].data, NULL, spans[i].size);
+	}
+	int retVal = _backend.writev(spans, count, csChange);
+	if (retVal > 0) _statBytes += retVal;
+	return retVal;
+}
+
+// Pushes every frame of the transaction to the bus, each one framed by its own
+// chip select cycle, in as few driver submissions as the backend allows
+int SPIdev::submit(const SPITransaction& transaction)
+{
+	if (transaction.empty()) return 0;
+	waitIdle();
+	if (_trace)
+	{
+		for (uint32_t i = 0; i < transaction.frames(); i++)
 		{
-			_spi_mode = SPI_MODE_3;
-			break;
+			_trace->select();
+			_trace->transfer(transaction.frameData(i), NULL, transaction.frameSize(i));
+			_trace->deselect();
 		}
 	}
-	if (_spiChannel == 0)
+	int retVal = _backend.submit(transaction);
+	if (retVal < 0) return retVal;
+	_statBytes += transaction.size();
+	_statCsCycles += transaction.frames();
+	return retVal;
+}
+
+void SPIdev::write8(uint8_t data, bool csChange)
+{
+	write(&data, 1, csChange);
+}
+
+void SPIdev::write16(uint16_t data, bool csChange)
+{
+	write((const uint8_t*)&data, 2, csChange);
+}
+
+uint8_t SPIdev::transfer8(uint8_t data, bool csChange)
+{
+	uint8_t buff = data;
+	if (_backend.transfer(&data, &buff, 1, csChange) > 0) _statBytes++;
+	if (_trace) _trace->transfer(&data, &buff, 1);
+	return buff;
+}
+
+uint16_t SPIdev::transfer16(uint16_t data, bool csChange)
+{
+	uint16_t buff = data;
+	if (_backend.transfer((const uint8_t*)&data, (uint8_t*)&buff, 2, csChange) > 0) _statBytes += 2;
+	if (_trace) _trace->transfer((const uint8_t*)&data, (uint8_t*)&buff, 2);
+	return buff;
+}
+
+///////////////// Asynchronous submission
+
+// Starts the I/O thread and allocates the staging buffers it drains.
+// While it runs, every synchronous access first waits for the queue to empty.
+bool SPIdev::startAsync(uint32_t stagingSize)
+{
+	if (_asyncRunning) return stagingSize <= _stagingSize;
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
 	{
-		_spiFileHandle = open(std::string("/dev/spidev0.0").c_str(), O_RDWR);
+		_staging[i] = new uint8_t[stagingSize];
+		_stagingFence[i] = 0;
+		_stagingHeld[i] = false;
 	}
-	else 
+	_stagingSize = stagingSize;
+	_stagingNext = 0;
+	_asyncRunning = true;
+	_ioThread = std::thread(&SPIdev::ioThread, this);
+	return true;
+}
+
+void SPIdev::stopAsync()
+{
+	if (!_asyncRunning) return;
+	waitIdle();
 	{
-		_spiFileHandle = open(std::string("/dev/spidev0.1").c_str(), O_RDWR);
+		std::lock_guard<std::mutex> lock(_asyncLock);
+		_asyncRunning = false;
 	}
-	if (_spiFileHandle < 0) return false;
-	
-	status_value = ioctl(_spiFileHandle, SPI_IOC_WR_MODE, &_spi_mode);
-	if (status_value < 0) return false;
-	
-	status_value = ioctl(_spiFileHandle, SPI_IOC_RD_MODE, &_spi_mode);
-	if (status_value < 0) return false;
-	
-	status_value = ioctl(_spiFileHandle, SPI_IOC_WR_BITS_PER_WORD, &_spi_bitsPerWord);
-	if (status_value < 0) return false;
-	
-	status_value = ioctl(_spiFileHandle, SPI_IOC_RD_BITS_PER_WORD, &_spi_bitsPerWord);
-	if (status_value < 0) return false;
-	
-#elif defined(USE_SPI_BCM2835)
-	if (!bcm2835_init()) return false;
-	if (!bcm2835_spi_begin()) return false;
-	switch (mode)
+	_asyncWake.notify_all();
+	_ioThread.join();
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
 	{
-	case MODE_0:
-		{
-			_spi_mode = BCM2835_SPI_MODE0;
-			break;
-		}
-	case MODE_1:
-		{
-			_spi_mode = BCM2835_SPI_MODE1;
-			break;
-		}
-	case MODE_2:
-		{
-			_spi_mode = BCM2835_SPI_MODE2;
-			break;
-		}
-	case MODE_3:
-		{
-			_spi_mode = BCM2835_SPI_MODE3;
-			break;
-		}
+		delete[] _staging[i];
+		_staging[i] = NULL;
 	}
-	switch (bitsSizeOrder)
+	_stagingSize = 0;
+}
+
+// True when size bytes from data lie within one staging buffer
+bool SPIdev::isStaging(const uint8_t* data, uint32_t size) const
+{
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
 	{
-	case SPI_8BIT_MSB:
-		{
-			_spi_bitsOrder = BCM2835_SPI_BIT_ORDER_MSBFIRST;
-			_spi_bitsPerWord = 8;
-			break;
-		}
-	case SPI_8BIT_LSB:
-		{
-			_spi_bitsOrder = BCM2835_SPI_BIT_ORDER_LSBFIRST;
-			_spi_bitsPerWord = 8;
-			break;
-		}
-	case SPI_16BIT_MSB:
-		{
-			_spi_bitsOrder = BCM2835_SPI_BIT_ORDER_MSBFIRST;
-			_spi_bitsPerWord = 16;
-			break;
-		}
-	case SPI_16BIT_LSB:
+		if (_staging[i] && data >= _staging[i] && data < _staging[i] + _stagingSize)
+			return size <= (uint32_t)(_staging[i] + _stagingSize - data);
+	}
+	return false;
+}
+
+// Hands out the staging buffers round robin, waiting until the transfer that
+// last used the buffer has completed. A buffer stays held from here until it
+// is submitted and is skipped meanwhile; NULL when every buffer is held.
+uint8_t* SPIdev::acquireStaging()
+{
+	if (!_asyncRunning) return NULL;
+	for (int n = 0; n < SPI_ASYNC_BUFFERS; n++)
+	{
+		uint32_t i = _stagingNext;
+		_stagingNext = (_stagingNext + 1) % SPI_ASYNC_BUFFERS;
+		if (_stagingHeld[i]) continue;
+		waitFence(_stagingFence[i]);
+		_stagingHeld[i] = true;
+		return _staging[i];
+	}
+	return NULL;
+}
+
+// Hands a held buffer back without submitting it
+void SPIdev::releaseStaging(const uint8_t* staging)
+{
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
+	{
+		if (_staging[i] && staging >= _staging[i] && staging < _staging[i] + _stagingSize) _stagingHeld[i] = false;
+	}
+}
+
+SPIFence SPIdev::submitAsync(const SPITransaction& setup, uint8_t prefix, const uint8_t* staging, uint32_t dataSize)
+{
+	if (!_asyncRunning) return 0;
+	SPIAsyncJob* job = new SPIAsyncJob;
+	job->setup = setup;
+	job->prefix = prefix;
+	job->data = staging;
+	job->dataSize = dataSize;
+	{
+		std::lock_guard<std::mutex> lock(_asyncLock);
+		job->fence = ++_fenceSubmitted;
+		_asyncQueue.push_back(job);
+	}
+	for (int i = 0; i < SPI_ASYNC_BUFFERS; i++)
+	{
+		if (staging >= _staging[i] && staging < _staging[i] + _stagingSize)
 		{
-			_spi_bitsOrder = BCM2835_SPI_BIT_ORDER_LSBFIRST;
-			_spi_bitsPerWord = 16;
-			break;
+			_stagingFence[i] = job->fence;
+			_stagingHeld[i] = false;
 		}
 	}
-	bcm2835_spi_setBitOrder(_spi_bitsOrder);      // The default
-	bcm2835_spi_setDataMode(_spi_mode);                   // The default
-	bcm2835_spi_chipSelect(BCM2835_SPI_CS_NONE);                  // The default
-	bcm2835_gpio_fsel(_spiCSPin, BCM2835_GPIO_FSEL_OUTP);
-#endif
-	if (!setClockDiv(SPIClockDividerEnum::CLOCK_DIVIDER_1024)) return false;
-	return true;
+	_asyncWake.notify_one();
+	return job->fence;
 }
 
-void SPIdev::deinitialize()
+bool SPIdev::fenceDone(SPIFence fence)
 {
-#ifdef USE_SPI_DEVICE
-	close(_spiFileHandle);
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_spi_end();
-	bcm2835_close();
-#endif
+	std::lock_guard<std::mutex> lock(_asyncLock);
+	return _fenceCompleted >= fence;
 }
 
-void SPIdev::begin()
+// Blocks until the fence has been passed, timeoutMs = 0 waits forever
+bool SPIdev::waitFence(SPIFence fence, uint32_t timeoutMs)
 {
-#ifdef USE_SPI_DEVICE
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_gpio_write(_spiCSPin, LOW);
-#endif
+	std::unique_lock<std::mutex> lock(_asyncLock);
+	if (timeoutMs == 0)
+	{
+		_asyncDone.wait(lock, [&] { return _fenceCompleted >= fence; });
+		return true;
+	}
+	return _asyncDone.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return _fenceCompleted >= fence; });
 }
 
-void SPIdev::end()
+void SPIdev::waitIdle()
 {
-#ifdef USE_SPI_DEVICE
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_gpio_write(_spiCSPin, HIGH);
-#endif
+	if (!_asyncRunning || onIOThread()) return;
+	waitFence(_fenceSubmitted);
 }
 
-int SPIdev::write(uint8_t* data, uint32_t dataSize, bool csChange)
+void SPIdev::ioThread()
 {
-	int retVal = -1;
-#ifdef USE_SPI_DEVICE
-	const int chunkSize = 4096;
-	int chunksCount = dataSize > chunkSize ? dataSize / chunkSize  : dataSize;
-	struct spi_ioc_transfer spi;
-	memset(&spi, 0, sizeof(spi_ioc_transfer));
-	for (int i = 0; i < chunksCount; i++)
+	while (1)
 	{
-		spi.tx_buf = (unsigned long)(data + i * chunkSize); // transmit from "data"
-		if (chunksCount == 1)
-		{
-			spi.rx_buf = (unsigned long)(data + i * chunkSize); // receive into "data"
-			spi.len = dataSize;
-			spi.cs_change = csChange;
-		}
-		else
+		SPIAsyncJob* job;
 		{
-			spi.len = (i == (chunksCount - 1)) ? dataSize - chunkSize*(i + 1) : chunkSize;
-			spi.cs_change = (i == (chunksCount - 1)) ? csChange : !csChange;
+			std::unique_lock<std::mutex> lock(_asyncLock);
+			_asyncWake.wait(lock, [&] { return !_asyncQueue.empty() || !_asyncRunning; });
+			if (_asyncQueue.empty()) return;
+			job = _asyncQueue.front();
+			_asyncQueue.pop_front();
 		}
-	
-		retVal = ioctl(_spiFileHandle, SPI_IOC_MESSAGE(1), &spi);
-		if (retVal < 0)
+		useProfile(SPI_PROFILE_REG_WRITE);
+		submit(job->setup);
+		useProfile(SPI_PROFILE_BULK_WRITE);
+		begin();
+		SPISpan spans[2] = { { &job->prefix, 1 }, { job->data, job->dataSize } };
+		writev(spans, 2, false);
+		end();
 		{
-			perror("Error - Problem transmitting spi data..ioctl");
-			exit(1);
+			std::lock_guard<std::mutex> lock(_asyncLock);
+			_fenceCompleted = job->fence;
 		}
+		_asyncDone.notify_all();
+		delete job;
 	}
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_spi_writenb((char*)data, dataSize);
-	retVal = dataSize;
-#endif
-	return retVal;
 }
-
-uint8_t SPIdev::write8(uint8_t data, bool csChange)
-{
-	uint8_t buff = data;
-#ifdef USE_SPI_DEVICE
-	write((uint8_t*)&buff, 1, csChange);
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_spi_transfern((char*)&buff, 1);
-#endif
-	return buff;
-}
-
-uint16_t SPIdev::write16(uint16_t data, bool csChange)
-{
-	uint16_t buff = data;
-#ifdef USE_SPI_DEVICE
-	write((uint8_t*)&buff, 2, csChange);
-#elif defined(USE_SPI_BCM2835)
-	bcm2835_spi_transfern((char*)&buff, 2);
-#endif
-	return buff;
-}
\ No newline at end of file
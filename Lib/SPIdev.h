@@ -1,45 +1,28 @@
 #pragma once
 #include "def.h"
+#include "SPITypes.h"
+#include "SPISink.h"
+#include "BusConfig.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
-//#define USE_SPI_DEVICE
-#define USE_SPI_BCM2835
+#define SPI_ASYNC_BUFFERS	2
 
-typedef enum
-{
-	MODE_0 = 0x00, //CPOL:0, CPHA:0
-	MODE_1 = 0x02, //CPOL:0, CPHA:1
-	MODE_2 = 0x04, //CPOL:1, CPHA:0
-	MODE_3 = 0x08, //CPOL:1, CPHA:1
-} SPIDataModeEnum;
-
-typedef enum
-{
-	SPI_8BIT_MSB  = 0x00,
-	SPI_16BIT_MSB = 0x02,
-	SPI_8BIT_LSB  = 0x04,
-	SPI_16BIT_LSB = 0x08
-} SPIBitSizeOrderEnum;
+typedef uint32_t SPIFence;
 
-typedef enum
+// Work item of the asynchronous I/O thread: a register setup transaction
+// followed by one CS frame made of a prefix byte and a staging buffer
+struct SPIAsyncJob
 {
-	CLOCK_DIVIDER_65536 = 0,       ///< 65536 = 256us = 4kHz
-	CLOCK_DIVIDER_32768 = 32768,   ///< 32768 = 126us = 8kHz
-	CLOCK_DIVIDER_16384 = 16384,   ///< 16384 = 64us = 15.625kHz
-	CLOCK_DIVIDER_8192  = 8192,    ///< 8192 = 32us = 31.25kHz
-	CLOCK_DIVIDER_4096  = 4096,    ///< 4096 = 16us = 62.5kHz
-	CLOCK_DIVIDER_2048  = 2048,    ///< 2048 = 8us = 125kHz
-	CLOCK_DIVIDER_1024  = 1024,    ///< 1024 = 4us = 250kHz
-	CLOCK_DIVIDER_512   = 512,     ///< 512 = 2us = 500kHz
-	CLOCK_DIVIDER_256   = 256,     ///< 256 = 1us = 1MHz
-	CLOCK_DIVIDER_128   = 128,     ///< 128 = 500ns = = 2MHz
-	CLOCK_DIVIDER_64    = 64,      ///< 64 = 250ns = 4MHz
-	CLOCK_DIVIDER_32    = 32,      ///< 32 = 125ns = 8MHz
-	CLOCK_DIVIDER_16    = 16,      ///< 16 = 50ns = 20MHz
-	CLOCK_DIVIDER_8     = 8,       ///< 8 = 25ns = 40MHz
-	CLOCK_DIVIDER_4     = 4,       ///< 4 = 12.5ns 80MHz
-	CLOCK_DIVIDER_2     = 2,       ///< 2 = 6.25ns = 160MHz
-	CLOCK_DIVIDER_1     = 1,       ///< 0 = 256us = 4kHz
-} SPIClockDividerEnum;
+	SPITransaction setup;
+	uint8_t prefix;
+	const uint8_t* data;
+	uint32_t dataSize;
+	SPIFence fence;
+};
 
 class SPIdev
 {
@@ -48,23 +31,61 @@ public:
 	~SPIdev();
 	bool initialize(SPIDataModeEnum mode, SPIBitSizeOrderEnum bitsSizeOrder);
 	void deinitialize();
-	int write(uint8_t* data, uint32_t dataSize, bool csChange);
-	uint8_t write8(uint8_t data, bool csChange);
-	uint16_t write16(uint16_t data, bool csChange);
+	// Depending on the backend, buffers written between begin() and end() may be
+	// queued by reference and must stay untouched until end()
+	int write(const uint8_t* data, uint32_t dataSize, bool csChange);
+	int writev(const SPISpan* spans, uint32_t count, bool csChange);
+	void write8(uint8_t data, bool csChange);
+	void write16(uint16_t data, bool csChange);
+	uint8_t transfer8(uint8_t data, bool csChange);
+	uint16_t transfer16(uint16_t data, bool csChange);
 	void begin();
 	void end();
+	int submit(const SPITransaction& transaction);
 	bool setClockDiv(SPIClockDividerEnum clockDivider);
+	void setProfileDivider(SPIClockProfileEnum profile, SPIClockDividerEnum clockDivider);
+	SPIClockDividerEnum getProfileDivider(SPIClockProfileEnum profile) const { return _profileDivider[profile]; }
+	bool useProfile(SPIClockProfileEnum profile);
+	SPIStats stats() const;
+	void resetStats();
+
+	bool startAsync(uint32_t stagingSize);
+	void stopAsync();
+	bool isAsync() const { return _asyncRunning; }
+	uint32_t stagingSize() const { return _stagingSize; }
+	bool isStaging(const uint8_t* data, uint32_t size = 1) const;
+	uint8_t* acquireStaging();
+	void releaseStaging(const uint8_t* staging);
+	SPIFence submitAsync(const SPITransaction& setup, uint8_t prefix, const uint8_t* staging, uint32_t dataSize);
+	bool fenceDone(SPIFence fence);
+	bool waitFence(SPIFence fence, uint32_t timeoutMs = 0);
+	void waitIdle();
+
+	// Mirrors every bus event into the sink, e.g. an SPITraceRecorder
+	void setTrace(SPISink* trace);
 private:
+	SPIBackend _backend;
 	uint8_t _spiChannel;
-	uint8_t _spiCSPin;
-	uint8_t _spi_mode;
-	uint8_t _spi_bitsOrder;
-	uint8_t _spi_bitsPerWord;
 	uint16_t _spi_clockDivider;
-	
-#if defined(USE_SPI_DEVICE)
-	int _spiFileHandle;
-	bool _spiTriggerCS;
-#elif defined(USE_SPI_BCM2835)
-#endif
+	SPIClockDividerEnum _profileDivider[SPI_PROFILE_COUNT];
+	std::atomic<uint32_t> _statBytes;      ///< SPIStats::bytes, also counted by the I/O thread
+	std::atomic<uint32_t> _statCsCycles;   ///< SPIStats::csCycles
+	SPISink* _trace;
+
+	bool _asyncRunning;
+	std::thread _ioThread;
+	std::mutex _asyncLock;
+	std::condition_variable _asyncWake;
+	std::condition_variable _asyncDone;
+	std::deque<SPIAsyncJob*> _asyncQueue;
+	uint8_t* _staging[SPI_ASYNC_BUFFERS];
+	SPIFence _stagingFence[SPI_ASYNC_BUFFERS];
+	bool _stagingHeld[SPI_ASYNC_BUFFERS];   ///< Handed out and not submitted yet
+	uint32_t _stagingSize;
+	uint32_t _stagingNext;
+	SPIFence _fenceSubmitted;
+	SPIFence _fenceCompleted;
+
+	void ioThread();
+	bool onIOThread() const { return _asyncRunning && std::this_thread::get_id() == _ioThread.get_id(); }
 };
\ No newline at end of file
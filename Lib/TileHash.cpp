@@ -0,0 +1,72 @@
+#include "TileHash.h"
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TILE_HASH_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TILE_HASH_SSE2
+#endif
+
+#define TILE_HASH_SEED	5381
+
+static const uint32_t laneFold[8] =
+{
+	0x9E3779B1, 0x85EBCA77, 0xC2B2AE3D, 0x27D4EB2F, 0x165667B1, 0xD3A2646D, 0xFD7046C5, 0xB55A4F09
+};
+
+uint32_t tileHash(const uint16_t* pixels, uint32_t stride, uint32_t w, uint32_t h)
+{
+	uint32_t lanes[8];
+	uint32_t vectorWidth = w & ~7;
+#if defined(TILE_HASH_NEON)
+	uint32x4_t lo = vdupq_n_u32(TILE_HASH_SEED), hi = lo;
+	for (uint32_t y = 0; y < h; y++)
+	{
+		const uint16_t* row = pixels + y * stride;
+		for (uint32_t x = 0; x < vectorWidth; x += 8)
+		{
+			uint16x8_t v = vld1q_u16(row + x);
+			lo = veorq_u32(vaddq_u32(vshlq_n_u32(lo, 5), lo), vmovl_u16(vget_low_u16(v)));
+			hi = veorq_u32(vaddq_u32(vshlq_n_u32(hi, 5), hi), vmovl_u16(vget_high_u16(v)));
+		}
+	}
+	vst1q_u32(lanes, lo);
+	vst1q_u32(lanes + 4, hi);
+#elif defined(TILE_HASH_SSE2)
+	__m128i lo = _mm_set1_epi32(TILE_HASH_SEED), hi = lo, zero = _mm_setzero_si128();
+	for (uint32_t y = 0; y < h; y++)
+	{
+		const uint16_t* row = pixels + y * stride;
+		for (uint32_t x = 0; x < vectorWidth; x += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+			lo = _mm_xor_si128(_mm_add_epi32(_mm_slli_epi32(lo, 5), lo), _mm_unpacklo_epi16(v, zero));
+			hi = _mm_xor_si128(_mm_add_epi32(_mm_slli_epi32(hi, 5), hi), _mm_unpackhi_epi16(v, zero));
+		}
+	}
+	_mm_storeu_si128((__m128i*)lanes, lo);
+	_mm_storeu_si128((__m128i*)(lanes + 4), hi);
+#else
+	for (int i = 0; i < 8; i++) lanes[i] = TILE_HASH_SEED;
+	for (uint32_t y = 0; y < h; y++)
+	{
+		const uint16_t* row = pixels + y * stride;
+		for (uint32_t x = 0; x < vectorWidth; x++)
+		{
+			lanes[x & 7] = (lanes[x & 7] * 33) ^ row[x];
+		}
+	}
+#endif
+	// Columns past the last multiple of eight
+	for (uint32_t y = 0; y < h; y++)
+	{
+		const uint16_t* row = pixels + y * stride;
+		for (uint32_t x = vectorWidth; x < w; x++)
+		{
+			lanes[x & 7] = (lanes[x & 7] * 33) ^ row[x];
+		}
+	}
+	uint32_t hash = 0;
+	for (int i = 0; i < 8; i++) hash += lanes[i] * laneFold[i];
+	return hash;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+// Hash of a w x h block of RGB565 pixels, stride in pixels. Every pixel goes
+// through one of eight 32-bit lanes as lane = lane * 33 ^ pixel, and the lanes
+// are folded with odd multipliers at the end. Both steps are invertible, so a
+// single changed pixel always changes the hash. NEON and SSE2 builds compute
+// the lanes eight pixels at a time and give the same result as the scalar one.
+uint32_t tileHash(const uint16_t* pixels, uint32_t stride, uint32_t w, uint32_t h);
@@ -1,91 +1,214 @@
 #include "ra8875.h"
 #include "ra8875_regs.h"
+#include <algorithm>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 
 
-// Command/Data pins for SPI
-#define RA8875_DATAWRITE        0x00
-#define RA8875_DATAREAD         0x40
-#define RA8875_CMDWRITE         0x80
-#define RA8875_CMDREAD          0xC0
-
-#define DEFAULT_HIGH_SPI_CLOCK SPIClockDividerEnum::CLOCK_DIVIDER_16
 #define DEFAULT_LOW_SPI_CLOCK SPIClockDividerEnum::CLOCK_DIVIDER_1024
 
+#define SPI_CALIBRATION_PIXELS 32
+
+// Calibration candidates, slowest first
+static const SPIClockDividerEnum spiClockCandidates[] =
+{
+	CLOCK_DIVIDER_1024, CLOCK_DIVIDER_512, CLOCK_DIVIDER_256, CLOCK_DIVIDER_128,
+	CLOCK_DIVIDER_64, CLOCK_DIVIDER_32, CLOCK_DIVIDER_16, CLOCK_DIVIDER_8, CLOCK_DIVIDER_4
+};
+
 RA8875::RA8875(uint8_t spiChannel, uint32_t resetPin)
 {
 	_resetPin = resetPin;
 	_spi = new SPIdev(spiChannel);
 	_textScale = 0;
+	resetTextPacing();
+	_batchDepth = 0;
+	memset(&_primitiveStats, 0, sizeof(_primitiveStats));
+	_cmdReg = 0;
+	syncRegisters();
+	_pipelined = false;
+	_pendingReg = 0;
+	_pendingFlag = 0;
+	_pendingIrq = 0;
+	_frontLayer = Layer1;
+	_copyBack = false;
+	_damageLeft = _damageTop = 0x7FFF;
+	_damageRight = _damageBottom = -1;
+	_pollTimeoutMs = RA8875_POLL_TIMEOUT_MS;
+	_error = NoError;
+	resetPollStats();
+	resetBatchStats();
+	_hostBuffer = NULL;
 }
 
 RA8875::~RA8875()
 {
+	_int.close();
+	_vsync.close();
 	delete _spi;
 }
 
+// Register traffic is staged in _tx and goes out in one submission once the
+// outermost batch ends; outside of a batch every frame is sent immediately
+void RA8875::queueFrame(uint8_t b0, uint8_t b1)
+{
+	if (!_tx.frame(b0, b1))
+	{
+		flushRegs();
+		_tx.frame(b0, b1);
+	}
+	if (_batchDepth == 0) flushRegs();
+}
+
+void RA8875::flushRegs()
+{
+	if (_tx.empty()) return;
+	_spi->useProfile(SPI_PROFILE_REG_WRITE);
+	_spi->submit(_tx);
+	_tx.clear();
+}
+
+void RA8875::beginPrimitive()
+{
+	if (_batchDepth++ == 0) _primitiveStart = _spi->stats();
+}
+
+void RA8875::endPrimitive()
+{
+	if (--_batchDepth > 0) return;
+	flushRegs();
+	SPIStats now = _spi->stats();
+	_primitiveStats.bytes = now.bytes - _primitiveStart.bytes;
+	_primitiveStats.csCycles = now.csCycles - _primitiveStart.csCycles;
+	_primitiveStats.submissions = now.submissions - _primitiveStart.submissions;
+}
+
+void RA8875::setForeColor(uint16_t color)
+{
+	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
+	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
+	writeReg(RA8875_FGCR2, (color & 0x001f));
+}
+
+void RA8875::setBackColor(uint16_t color)
+{
+	writeReg(RA8875_BGCR0, (color & 0xf800) >> 11);
+	writeReg(RA8875_BGCR1, (color & 0x07e0) >> 5);
+	writeReg(RA8875_BGCR2, (color & 0x001f));
+}
+
+// Registers the chip itself changes: trigger and status bits, auto-advancing
+// cursors, touch samples and interrupt flags. They bypass the shadow copy.
+static bool isVolatileReg(uint8_t reg)
+{
+	switch (reg)
+	{
+	case RA8875_MRWC:
+	case RA8875_F_CURXL: case RA8875_F_CURXH: case RA8875_F_CURYL: case RA8875_F_CURYH:
+	case RA8875_CURH0: case RA8875_CURH1: case RA8875_CURV0: case RA8875_CURV1:
+	case RA8875_RCURH0: case RA8875_RCURH1: case RA8875_RCURV0: case RA8875_RCURV1:
+	case RA8875_BECR0:
+	case RA8875_TPXH: case RA8875_TPYH: case RA8875_TPXYL:
+	case RA8875_MCLR:
+	case RA8875_DCR:
+	case RA8875_ELLIPSE:
+	case RA8875_DMACR:
+	case RA8875_INTC2:
+		return true;
+	}
+	return false;
+}
+
 void RA8875::writeData(uint8_t data)
 {
-	_spi->begin();
-	_spi->write8(RA8875_DATAWRITE, true);
-	_spi->write8(data, false);
-	_spi->end();
+	if (!isVolatileReg(_cmdReg))
+	{
+		_shadow[_cmdReg] = data;
+		_shadowValid[_cmdReg] = true;
+	}
+	queueFrame(RA8875_DATAWRITE, data);
 }
 
-void RA8875::writeData(uint8_t* data, uint32_t dataSize)
+void RA8875::writeData(const uint8_t* data, uint32_t dataSize)
 {
+	static const uint8_t prefix = RA8875_DATAWRITE;
+	SPISpan spans[2] = { { &prefix, 1 }, { data, dataSize } };
+	flushRegs();
+	_spi->useProfile(SPI_PROFILE_BULK_WRITE);
 	_spi->begin();
-	_spi->write8(RA8875_DATAWRITE, true);
-	_spi->write(data, dataSize, false);
+	_spi->writev(spans, 2, false);
 	_spi->end();
 }
 
 void RA8875::writeCommand(uint8_t cmd)
 {
-	_spi->begin();
-	_spi->write8(RA8875_CMDWRITE, true);
-	_spi->write8(cmd, false);
-	_spi->end();
+	_cmdReg = cmd;
+	queueFrame(RA8875_CMDWRITE, cmd);
 }
 
 uint8_t RA8875::readData(void)
 {
+	flushRegs();
+	_spi->useProfile(SPI_PROFILE_REG_READ);
 	_spi->begin();
 	_spi->write8(RA8875_DATAREAD, true);
-	uint8_t r =  _spi->write8(0, false);
+	uint8_t r =  _spi->transfer8(0, false);
 	_spi->end();
 	return r;
 }
 
 uint8_t RA8875::readStatus(void)
 {
+	flushRegs();
+	_spi->useProfile(SPI_PROFILE_REG_READ);
 	_spi->begin();
 	_spi->write8(RA8875_CMDREAD, true);
-	uint8_t r = _spi->write8(0, false);
+	uint8_t r = _spi->transfer8(0, false);
 	_spi->end();
 	return r;
 }
 
+// Writes that would not change the shadowed value never reach the bus
 void RA8875::writeReg(uint8_t reg, uint8_t val)
 {
+	if (_shadowValid[reg] && _shadow[reg] == val) return;
 	writeCommand(reg);
 	writeData(val);
 }
 
 void RA8875::writeReg16(uint8_t reg, uint16_t val)
 {
-	writeCommand(reg);
-	writeData((uint16_t)(val)& 0xFF);
-	writeCommand(reg+1);
-	writeData((uint16_t)(val) >> 8);
+	writeReg(reg, val & 0xFF);
+	writeReg(reg + 1, val >> 8);
 }
 
+// Always goes to the chip, and refreshes the shadow copy on the way
 uint8_t RA8875::readReg(uint8_t reg)
 {
 	writeCommand(reg);
-	return readData();
+	uint8_t r = readData();
+	if (!isVolatileReg(reg))
+	{
+		_shadow[reg] = r;
+		_shadowValid[reg] = true;
+	}
+	return r;
+}
+
+// Current value of a register for read-modify-write, from the shadow copy
+// when it is known
+uint8_t RA8875::shadowReg(uint8_t reg)
+{
+	if (_shadowValid[reg]) return _shadow[reg];
+	return readReg(reg);
+}
+
+// Forgets the shadow copy after the chip may have lost its registers, so every
+// register is read back on its next use
+void RA8875::syncRegisters()
+{
+	memset(_shadowValid, 0, sizeof(_shadowValid));
 }
 
 bool RA8875::PLLinit(void)
@@ -109,6 +232,7 @@ void RA8875::hardReset(void)
 	delay(1);
 	digitalWrite(_resetPin, HIGH);
 	delay(10);
+	syncRegisters();
 }
 
 void RA8875::softReset(void)
@@ -117,21 +241,170 @@ void RA8875::softReset(void)
 	writeData(RA8875_PWRR_SOFTRESET);
 	writeData(RA8875_PWRR_NORMAL);
 	delay(1);
+	syncRegisters();
 }
 
+// Polls until the flag clears. The first polls follow each other directly, then
+// the pause between them doubles up to RA8875_POLL_BACKOFF_MAX_US. Gives up with
+// PollTimeout after the poll timeout.
 bool RA8875::waitPoll(uint8_t regname, uint8_t waitflag)
 {
-	/* Wait for the command to finish */
+	uint32_t start = millis();
+	uint32_t backoff = RA8875_POLL_BACKOFF_MIN_US;
+	_pollStats.waits++;
+	for (uint32_t i = 0; ; i++)
+	{
+		_pollStats.polls++;
+		if (!(readReg(regname) & waitflag)) return true;
+		if (millis() - start > _pollTimeoutMs)
+		{
+			_pollStats.timeouts++;
+			_error = PollTimeout;
+			return false;
+		}
+		if (i >= RA8875_POLL_SPIN)
+		{
+			delayMicroseconds(backoff);
+			_pollStats.sleeps++;
+			if (backoff < RA8875_POLL_BACKOFF_MAX_US) backoff <<= 1;
+		}
+	}
+}
+
+// Records the engine operation just kicked off. Outside of pipelined mode it
+// is waited for right away, as before. Operations that raise an interrupt
+// (irq = RA8875_INTC2_BTE, RA8875_INTC2_DMA) get it routed to INT when the
+// INT line is hooked up; the INTC2 status bit latches whether or not it is
+// enabled, so enabling it after the start is not racy.
+void RA8875::engineStarted(uint8_t regname, uint8_t waitflag, uint8_t irq)
+{
+	_pendingReg = regname;
+	_pendingFlag = waitflag;
+	_pendingIrq = irq;
+	if (irq && _int.isOpen()) writeReg(RA8875_INTC1, shadowReg(RA8875_INTC1) | irq);
+	if (!_pipelined) waitEngine();
+}
+
+// Waits for the last engine operation, if any is still outstanding. With an
+// interrupt the bus stays quiet until INT goes low; INT is shared with touch,
+// so INTC2 tells whether it was our completion.
+bool RA8875::waitEngine()
+{
+	if (_pendingFlag == 0) return true;
+	uint8_t flag = _pendingFlag;
+	uint8_t irq = _pendingIrq;
+	_pendingFlag = 0;
+	_pendingIrq = 0;
+	if (irq == 0) return waitPoll(_pendingReg, flag);
+	if (!_int.isOpen())
+	{
+		// The flag latches anyway, a stale one would end the next wait early
+		bool done = waitPoll(_pendingReg, flag);
+		writeReg(RA8875_INTC2, irq);
+		return done;
+	}
+
+	uint32_t start = millis();
+	_pollStats.waits++;
 	while (1)
 	{
-		uint8_t temp = readReg(regname);
-		if (!(temp & waitflag))
-			return 1;
+		_pollStats.polls++;
+		if (readReg(RA8875_INTC2) & irq)
+		{
+			writeReg(RA8875_INTC2, irq);
+			return true;
+		}
+		uint32_t elapsed = millis() - start;
+		if (elapsed > _pollTimeoutMs) break;
+		_pollStats.sleeps++;
+		waitInterrupt(_pollTimeoutMs - elapsed + 1);
+	}
+	_pollStats.timeouts++;
+	_error = PollTimeout;
+	return false;
+}
+
+// Hooks up the RA8875 INT output (active low, BCM GPIO numbering). Engine
+// completion and touch are then taken from edges on it instead of polling.
+bool RA8875::setInterruptPin(uint32_t gpio)
+{
+	flush();
+	return _int.open(gpio, GPIO_EDGE_FALLING);
+}
+
+// Sleeps until INT is asserted or the timeout expires. INT stays low until the
+// INTC2 flag behind it is cleared, so a line that is already low returns
+// right away. Without an INT pin it just sleeps and returns false.
+bool RA8875::waitInterrupt(uint32_t timeoutMs)
+{
+	if (!_int.isOpen())
+	{
+		delay(timeoutMs);
+		return false;
 	}
-	return 0; // MEMEFIX: yeah i know, unreached! - add timeout?
+	_int.clear();
+	if (!_int.level()) return true;
+	return _int.wait(timeoutMs) > 0;
+}
+
+// In pipelined mode primitives return as soon as the engine has been started and
+// the busy check moves to the next command that needs the engine or display RAM
+void RA8875::setPipelined(bool pipelined)
+{
+	if (!pipelined) flush();
+	_pipelined = pipelined;
+}
+
+// Pushes out staged register writes and waits for the engine to go idle
+bool RA8875::flush()
+{
+	flushRegs();
+	return waitEngine();
+}
+
+void RA8875::resetPollStats()
+{
+	memset(&_pollStats, 0, sizeof(_pollStats));
 }
 
 bool RA8875::initialize(uint8_t mode)
+{
+	hardReset();
+	if (!_spi->initialize(SPIDataModeEnum::MODE_0, SPIBitSizeOrderEnum::SPI_8BIT_MSB)) return false;
+	if (!PLLinit())
+	{
+		return false;
+	}
+	programDisplay(mode);
+
+	// Calibration clocks the bus at dividers that may fail and a garbled command
+	// can land on any register, PWRR and the PLL included. Start over from a reset
+	// at the clocks it settled on, all of them slow when it failed.
+	calibrateSPIClock();
+	hardReset();
+	if (!PLLinit())
+	{
+		return false;
+	}
+	programDisplay(mode);
+
+	clearMemory(true);
+	setCursorBlinkRate(255);
+	showCursor(false, false);
+	setFontSource(RA8875FontSourceEnum::INT_CGROM);
+	selectMemory(RA8875MemoryEnum::Layer1);
+	
+	touchEnable(true);
+	
+	PWM1config(true, RA8875_PWM_CLK_DIV1024);
+	PWM1out(255);
+	displayOn(true);
+	return true;
+}
+
+// Color depth, pixel clock and panel timing for the mode, then the full screen
+// as active window
+void RA8875::programDisplay(uint8_t mode)
 {
 	uint8_t pixclk;
 	uint8_t hsync_start;
@@ -169,13 +442,6 @@ bool RA8875::initialize(uint8_t mode)
 		vsync_pw = 2;
 	}
 
-	hardReset();
-	if (!_spi->initialize(SPIDataModeEnum::MODE_0, SPIBitSizeOrderEnum::SPI_8BIT_MSB)) return false;
-	if (!PLLinit())
-	{
-		return false;
-	}
-
 	writeReg(RA8875_SYSR, RA8875_SYSR_16BPP | RA8875_SYSR_MCU8);
 	writeReg(RA8875_PCSR, pixclk);
 	delay(1);
@@ -196,64 +462,121 @@ bool RA8875::initialize(uint8_t mode)
 	writeReg(RA8875_DPCR, RA8875_DPCR_HDIR0 | RA8875_DPCR_VDIR0 | RA8875_DPCR_L1);
 	
 	setActiveWindow(0, 0, _width - 1, _height - 1);
+}
 
-	clearMemory(true);
-	setCursorBlinkRate(255);
-	showCursor(false, false);
-	setFontSource(RA8875FontSourceEnum::INT_CGROM);
-	selectMemory(RA8875MemoryEnum::Layer1);
-	
-	touchEnable(true);
-	
-	PWM1config(true, RA8875_PWM_CLK_DIV1024);
-	PWM1out(255);
-	displayOn(true);
-	
-	_spi->setClockDiv(DEFAULT_HIGH_SPI_CLOCK);
+// Writes test patterns to the BTE coordinate registers and to the first pixels of
+// display RAM and reads them back. Runs before the initial clearMemory.
+bool RA8875::spiRoundTrip()
+{
+	static const uint8_t patterns[] = { 0x55, 0xAA, 0x00, 0xFF, 0x5A, 0xA5, 0x3C, 0xC3 };
+	static const uint8_t regs[] = { RA8875_HSBE0, RA8875_VSBE0, RA8875_HDBE0, RA8875_VDBE0, RA8875_BEWR0, RA8875_BEHR0 };
+	for (uint32_t i = 0; i < sizeof(patterns); i++)
+	{
+		uint8_t reg = regs[i % sizeof(regs)];
+		writeCommand(reg); // not writeReg, the pattern has to cross the bus every round
+		writeData(patterns[i]);
+		if (readReg(reg) != patterns[i]) return false;
+	}
+
+	uint8_t pixels[SPI_CALIBRATION_PIXELS * 2];
+	for (uint32_t i = 0; i < sizeof(pixels); i++)
+	{
+		pixels[i] = patterns[i % sizeof(patterns)] ^ i;
+	}
+	setXY(0, 0);
+	writeCommand(RA8875_MRWC);
+	writeData(pixels, sizeof(pixels));
+	writeReg16(RA8875_RCURH0, 0);
+	writeReg16(RA8875_RCURV0, 0);
+	writeCommand(RA8875_MRWC);
+	readData(); // the first memory read returns a dummy byte
+	for (uint32_t i = 0; i < sizeof(pixels); i++)
+	{
+		if (readData() != pixels[i]) return false;
+	}
 	return true;
 }
 
+// Finds the fastest divider per clock profile that survives spiRoundTrip while
+// the other profiles stay at the slow reference clock, then backs off one step
+// for margin
+bool RA8875::calibrateSPIClock()
+{
+	const int count = sizeof(spiClockCandidates) / sizeof(spiClockCandidates[0]);
+	SPIClockDividerEnum best[SPI_PROFILE_COUNT];
+	bool ok = true;
+	for (int p = 0; p < SPI_PROFILE_COUNT && ok; p++)
+	{
+		int passed = -1;
+		for (int i = 0; i < count; i++)
+		{
+			for (int q = 0; q < SPI_PROFILE_COUNT; q++)
+			{
+				_spi->setProfileDivider((SPIClockProfileEnum)q, q == p ? spiClockCandidates[i] : DEFAULT_LOW_SPI_CLOCK);
+			}
+			if (!spiRoundTrip()) break;
+			passed = i;
+		}
+		ok = passed >= 0;
+		best[p] = spiClockCandidates[passed > 0 ? passed - 1 : 0];
+	}
+	for (int p = 0; p < SPI_PROFILE_COUNT; p++)
+	{
+		_spi->setProfileDivider((SPIClockProfileEnum)p, ok ? best[p] : DEFAULT_LOW_SPI_CLOCK);
+	}
+	// Writes at a failing clock may not have reached the chip
+	syncRegisters();
+	resetTextPacing();
+	return ok;
+}
+
 void RA8875::deinitialize()
 {
+	flush();
 	_spi->deinitialize();
 }
 
 void RA8875::setActiveWindow(uint32_t left, uint32_t top, uint32_t right, uint32_t bottom)
 {
+	waitEngine();
+	beginPrimitive();
 	writeReg16(RA8875_HSAW0, left);
 	writeReg16(RA8875_HEAW0, right);
 	writeReg16(RA8875_VSAW0, top);
 	writeReg16(RA8875_VEAW0, bottom);
 	writeReg16(RA8875_CURH0, left);
 	writeReg16(RA8875_CURV0, top);
+	endPrimitive();
 }
 
 void RA8875::clearMemory(bool full)
 {
 	uint8_t temp = RA8875_MCLR_START;
 	if (!full) temp |= RA8875_MCLR_ACTIVE;
+	waitEngine();
 	writeReg(RA8875_MCLR, temp);
-	waitPoll(RA8875_MCLR, RA8875_MCLR_READSTATUS);
+	engineStarted(RA8875_MCLR, RA8875_MCLR_READSTATUS);
 }
 
 void RA8875::setMode(RA8875ModeEnum mode)
 {
 	if (mode == _mode) return;
+	waitEngine();
 	_mode = mode;
 	/* Set text mode */
-	writeCommand(RA8875_MWCR0);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_MWCR0);
 	if (mode == RA8875ModeEnum::GRAPHIC)
 		temp &= ~RA8875_MWCR0_TXTMODE; // bit #7
 	else
 		temp |= RA8875_MWCR0_TXTMODE; // Set bit 7
-	writeData(temp);
+	writeReg(RA8875_MWCR0, temp);
 }
 
 void RA8875::selectMemory(RA8875MemoryEnum memory)
 {
 	uint8_t regFNCR0;
-	uint8_t regMWCR1 = readReg(RA8875_MWCR1);
+	waitEngine();
+	uint8_t regMWCR1 = shadowReg(RA8875_MWCR1);
 	switch (memory){
 	case RA8875MemoryEnum::Layer1:
 		regMWCR1 &= ~((1 << 3) | (1 << 2));// Clear bits 3 and 2
@@ -266,12 +589,9 @@ void RA8875::selectMemory(RA8875MemoryEnum memory)
 	case RA8875MemoryEnum::CGRAM:
 		regMWCR1 &= ~(1 << 3); //clear bit 3
 		regMWCR1 |= (1 << 2); //set bit 2
-		regFNCR0 = readReg(RA8875_FNCR0);
-		if (regFNCR0 & (1 << 7))
-		{
-			regFNCR0 &= ~(1 << 7); //clear bit 7
-			writeReg(RA8875_FNCR0, regFNCR0);
-		}
+		regFNCR0 = shadowReg(RA8875_FNCR0);
+		regFNCR0 &= ~(1 << 7); //clear bit 7
+		writeReg(RA8875_FNCR0, regFNCR0);
 		break;
 	case RA8875MemoryEnum::Pattern:
 		regMWCR1 |= (1 << 3); //set bit 3
@@ -285,11 +605,16 @@ void RA8875::selectMemory(RA8875MemoryEnum memory)
 	writeReg(RA8875_MWCR1, regMWCR1);
 }
 
+// Display RAM layer that drawing goes to
+RA8875MemoryEnum RA8875::getLayer()
+{
+	return (shadowReg(RA8875_MWCR1) & 0x01) ? Layer2 : Layer1;
+}
+
 void RA8875::setLayerMode(RA8875LayerModeEnum mode)
 {
-	writeCommand(RA8875_LTPR0);
-	uint8_t ltpr0 = readData() & ~0x7; // retain all but the display layer mode
-	writeData(ltpr0 | (mode & 0x7));
+	uint8_t ltpr0 = shadowReg(RA8875_LTPR0) & ~0x7; // retain all but the display layer mode
+	writeReg(RA8875_LTPR0, ltpr0 | (mode & 0x7));
 }
 
 void RA8875::setLayerTransparency(uint8_t layer1, uint8_t layer2)
@@ -299,16 +624,133 @@ void RA8875::setLayerTransparency(uint8_t layer1, uint8_t layer2)
 	writeReg(RA8875_LTPR1, ((layer2 & 0xF) << 4) | (layer1 & 0xF));
 }
 
+// Hardware scrolling only changes where the window content is shown from, the
+// display RAM stays as it is and wraps around inside the window: the row shown
+// at the top of the window is display RAM row top + getScrollY(). After
+// scroll(0, n) the n rows now shown at the bottom are the ones just scrolled
+// out at the top, ready to be redrawn.
+void RA8875::setScrollWindow(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom)
+{
+	beginPrimitive();
+	writeReg16(RA8875_HSSW0, left);
+	writeReg16(RA8875_VSSW0, top);
+	writeReg16(RA8875_HESW0, right);
+	writeReg16(RA8875_VESW0, bottom);
+	scrollTo(0, 0);
+	endPrimitive();
+}
+
+void RA8875::setScrollMode(RA8875ScrollModeEnum mode)
+{
+	uint8_t ltpr0 = shadowReg(RA8875_LTPR0) & ~0xC0; // retain all but the scroll mode
+	writeReg(RA8875_LTPR0, ltpr0 | ((mode & 0x3) << 6));
+}
+
+void RA8875::scrollTo(uint16_t x, uint16_t y)
+{
+	beginPrimitive();
+	writeReg16(RA8875_HOFS0, x & 0x7FF);
+	writeReg16(RA8875_VOFS0, y & 0x3FF);
+	endPrimitive();
+}
+
+// Moves the window content by dx, dy pixels; positive values scroll it left
+// and up, the way a log pane or a strip chart advances
+void RA8875::scroll(int16_t dx, int16_t dy)
+{
+	int32_t w = shadowReg16(RA8875_HESW0) - shadowReg16(RA8875_HSSW0) + 1;
+	int32_t h = shadowReg16(RA8875_VESW0) - shadowReg16(RA8875_VSSW0) + 1;
+	if (w <= 0 || h <= 0) return;
+	int32_t x = (getScrollX() + dx) % w;
+	int32_t y = (getScrollY() + dy) % h;
+	scrollTo(x < 0 ? x + w : x, y < 0 ? y + h : y);
+}
+
+uint16_t RA8875::getScrollX()
+{
+	return shadowReg16(RA8875_HOFS0);
+}
+
+uint16_t RA8875::getScrollY()
+{
+	return shadowReg16(RA8875_VOFS0);
+}
+
+///////////////// Double buffering
+
+// The panel VSYNC output (active low, BCM GPIO numbering). Its falling edge
+// starts the vertical non-display period, where endFrame can flip unseen.
+bool RA8875::setVsyncPin(uint32_t gpio)
+{
+	return _vsync.open(gpio, GPIO_EDGE_FALLING);
+}
+
+// Display RAM holds two layers at 8bpp, but at 16bpp only up to 480 pixels
+// wide. The 800x480 16bpp setup initialize() makes has a single layer.
+bool RA8875::hasLayer2()
+{
+	return !((shadowReg(RA8875_SYSR) & RA8875_SYSR_16BPP) && _width > 480);
+}
+
+// Directs drawing to the hidden layer, enabling both layers in DPCR. Refused
+// without a second layer, drawing then stays single buffered on layer 1.
+bool RA8875::beginFrame()
+{
+	if (!hasLayer2()) return false;
+	uint8_t dpcr = shadowReg(RA8875_DPCR);
+	if (!(dpcr & RA8875_DPCR_L2)) writeReg(RA8875_DPCR, dpcr | RA8875_DPCR_L2);
+	selectMemory(_frontLayer == Layer1 ? Layer2 : Layer1);
+	_damageLeft = _damageTop = 0x7FFF;
+	_damageRight = _damageBottom = -1;
+	return true;
+}
+
+// Area drawn in the current frame, copied back after the flip in copy-back mode
+void RA8875::addDamage(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	if (w <= 0 || h <= 0) return;
+	if (x < _damageLeft) _damageLeft = x;
+	if (y < _damageTop) _damageTop = y;
+	if (x + w - 1 > _damageRight) _damageRight = x + w - 1;
+	if (y + h - 1 > _damageBottom) _damageBottom = y + h - 1;
+}
+
+// Shows the finished frame once the engine is idle, at the next VSYNC when
+// asked to and the pin is set up. In copy-back mode the damaged area is then
+// copied into the layer that just went hidden, so the next frame only has to
+// draw what changes; otherwise the next frame has to redraw everything.
+// Without a second layer it only flushes and returns false.
+bool RA8875::endFrame(bool vsync)
+{
+	RA8875MemoryEnum back = _frontLayer == Layer1 ? Layer2 : Layer1;
+	flush();
+	if (!hasLayer2()) return false;
+	if (vsync && _vsync.isOpen())
+	{
+		_vsync.clear();
+		_vsync.wait(RA8875_VSYNC_TIMEOUT_MS);
+	}
+	setLayerMode(back == Layer2 ? OnlyLayer2 : OnlyLayer1);
+	RA8875MemoryEnum hidden = _frontLayer;
+	_frontLayer = back;
+	if (_copyBack && _damageRight >= _damageLeft)
+	{
+		copyRect(_frontLayer, _damageLeft, _damageTop, _damageRight - _damageLeft + 1, _damageBottom - _damageTop + 1,
+			hidden, _damageLeft, _damageTop);
+	}
+	selectMemory(_frontLayer);
+	return true;
+}
+
 void RA8875::setFontSource(RA8875FontSourceEnum source)
 {
 	/* Select the internal (ROM) font */
-	writeCommand(RA8875_FNCR0);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_FNCR0);
 	if (source == RA8875FontSourceEnum::INT_CGROM)
 		temp &= ~((1 << 7) | (1 << 5)); // Clear bits 7 and 5
 	else if (source == RA8875FontSourceEnum::INT_CGRAM)
 		temp |= (1 << 7);
-	writeData(temp);
+	writeReg(RA8875_FNCR0, temp);
 }
 
 void RA8875::textSetCursor(uint16_t x, uint16_t y)
@@ -320,34 +762,26 @@ void RA8875::textSetCursor(uint16_t x, uint16_t y)
 void RA8875::textColor(uint16_t foreColor, uint16_t bgColor)
 {
 	/* Set Fore Color */
-	writeReg(RA8875_FGCR0, (foreColor & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (foreColor & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (foreColor & 0x001f));
+	setForeColor(foreColor);
 
 	/* Set Background Color */
-	writeReg(RA8875_BGCR0, (bgColor & 0xf800) >> 11);
-	writeReg(RA8875_BGCR1, (bgColor & 0x07e0) >> 5);
-	writeReg(RA8875_BGCR2, (bgColor & 0x001f));
+	setBackColor(bgColor);
 
 	/* Clear transparency flag */
-	writeCommand(RA8875_FNCR1);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_FNCR1);
 	temp &= ~(1 << 6); // Clear bit 6
-	writeData(temp);
+	writeReg(RA8875_FNCR1, temp);
 }
 
 void RA8875::textTransparent(uint16_t foreColor)
 {
 	/* Set Fore Color */
-	writeReg(RA8875_FGCR0, (foreColor & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (foreColor & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (foreColor & 0x001f));
+	setForeColor(foreColor);
 
 	/* Set transparency flag */
-	writeCommand(RA8875_FNCR1);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_FNCR1);
 	temp |= (1 << 6); // Set bit 6
-	writeData(temp);
+	writeReg(RA8875_FNCR1, temp);
 }
 
 void RA8875::textEnlarge(uint8_t scale)
@@ -355,12 +789,11 @@ void RA8875::textEnlarge(uint8_t scale)
 	if (scale > 3) scale = 3;
 
 	/* Set font size flags */
-	writeCommand(RA8875_FNCR1);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_FNCR1);
 	temp &= ~(0xF); // Clears bits 0..3
 	temp |= scale << 2;
 	temp |= scale;
-	writeData(temp);
+	writeReg(RA8875_FNCR1, temp);
 
 	_textScale = scale;
 }
@@ -371,17 +804,48 @@ void RA8875::textWrite(int x, int y, const char *str, ...)
 	va_start(ap, str);
 	vsprintf(_textBuffer, str, ap);
 	va_end(ap);
+	waitEngine();
 	textSetCursor(x, y);
-	char *t = _textBuffer;
 	writeCommand(RA8875_MRWC);
-	while (*t != 0)
+	RA8875TextPacing& pacing = _textPacing[_textScale];
+	if (pacing.burst)
+	{
+		writeData((const uint8_t*)_textBuffer, strlen(_textBuffer));
+		return;
+	}
+	// Enlarged glyphs take a while to render and the chip drops characters
+	// written meanwhile, so each one waits for the memory busy bit to clear.
+	// A status read spans about three byte times while a burst leaves one
+	// between glyphs, so a glyph found done by the first read says nothing
+	// about bursts; these scales stay polled and the counters only report.
+	for (char *t = _textBuffer; *t != 0; t++)
 	{
 		writeData((uint8_t)(*t));
-		if (_textScale > 0) delay(1); // This delay is needed when CPU clock is high
-		t++;
+		uint32_t start = millis(), busy = 0;
+		while (readStatus() & RA8875_STSR_MEMBUSY)
+		{
+			busy++;
+			if (millis() - start > _pollTimeoutMs)
+			{
+				// The chip is stuck, the rest of the string would be lost anyway
+				_pollStats.timeouts++;
+				_error = PollTimeout;
+				return;
+			}
+		}
+		pacing.glyphs++;
+		pacing.busyPolls += busy;
+		if (busy > pacing.maxBusyPolls) pacing.maxBusyPolls = busy;
 	}
 }
 
+// Only unenlarged glyphs keep up with a burst, the other scales are polled
+void RA8875::resetTextPacing()
+{
+	memset(_textPacing, 0, sizeof(_textPacing));
+	_textPacing[0].burst = true;
+}
+
 void RA8875::uploadUserChar(const uint8_t symbol[], uint8_t address) {
 	setMode(RA8875ModeEnum::GRAPHIC);
 	writeReg(RA8875_CGSR, address); //CGRAM Space Select
@@ -397,8 +861,7 @@ void RA8875::uploadUserChar(const uint8_t symbol[], uint8_t address) {
 void RA8875::showCursor(bool show, bool blink)
 {
 	uint8_t curh = 0, curv = 0;
-	writeCommand(RA8875_MWCR0);
-	uint8_t temp = readData();
+	uint8_t temp = shadowReg(RA8875_MWCR0);
 	if (show) temp |= (1 << 6);
 	else temp &= ~(1 << 6);
 	if (blink) temp |= (1 << 5);
@@ -429,22 +892,335 @@ void RA8875::setXY(uint16_t x, uint16_t y)
 
 void RA8875::drawPixel(int16_t x, int16_t y, uint16_t color)
 {
+	waitEngine();
+	beginPrimitive();
 	writeReg16(RA8875_CURH0, x);
 	writeReg16(RA8875_CURV0, y);
 
 	writeCommand(RA8875_MRWC);
-	writeData(color);
+	writeData(color >> 8);
+	writeData(color & 0xFF);
+	endPrimitive();
+}
+
+static bool pixelBefore(const RA8875Pixel& a, const RA8875Pixel& b)
+{
+	return a.y != b.y ? a.y < b.y : a.x < b.x;
+}
+
+// Draws scattered pixels, each in its own color. They are sorted into
+// horizontal runs: a run costs one MRWC burst plus the cursor bytes that
+// differ from where the previous run left the cursor. With a host buffer
+// set (a _width x _height RGB565 copy of the layer, kept current by the
+// caller) it is updated too, and dense sets send their bounding box from it
+// as one block when that is fewer bytes than the runs.
+void RA8875::drawPixels(const RA8875Pixel* pixels, uint32_t count)
+{
+	_pixelScratch.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (pixels[i].x < 0 || pixels[i].y < 0 || pixels[i].x >= _width || pixels[i].y >= _height) continue;
+		_pixelScratch.push_back(pixels[i]);
+	}
+	if (_pixelScratch.empty()) return;
+	std::stable_sort(_pixelScratch.begin(), _pixelScratch.end(), pixelBefore);
+
+	// The last pixel given for a position wins; count runs and the bounding box
+	uint32_t n = 0, runBytes = 0;
+	int16_t left = _width, right = -1;
+	for (uint32_t i = 0; i < _pixelScratch.size(); i++)
+	{
+		RA8875Pixel& p = _pixelScratch[i];
+		if (n > 0 && p.x == _pixelScratch[n - 1].x && p.y == _pixelScratch[n - 1].y)
+		{
+			_pixelScratch[n - 1] = p;
+			continue;
+		}
+		if (n == 0 || p.y != _pixelScratch[n - 1].y || p.x != _pixelScratch[n - 1].x + 1) runBytes += RA8875_RUN_OVERHEAD;
+		runBytes += 2;
+		if (p.x < left) left = p.x;
+		if (p.x > right) right = p.x;
+		_pixelScratch[n++] = p;
+	}
+	_pixelScratch.resize(n);
+	int16_t top = _pixelScratch[0].y, bottom = _pixelScratch[n - 1].y;
+
+	if (_hostBuffer != NULL)
+	{
+		for (uint32_t i = 0; i < n; i++) _hostBuffer[_pixelScratch[i].y * _width + _pixelScratch[i].x] = _pixelScratch[i].color;
+		if ((uint32_t)(right - left + 1) * (bottom - top + 1) * 2 < runBytes)
+		{
+			writeHostRect(left, top, right, bottom);
+			return;
+		}
+	}
+
+	beginPrimitive();
+	setActiveWindow(0, 0, _width - 1, _height - 1);
+	uint16_t curX = 0, curY = 0; // where setActiveWindow left the cursor
+	for (uint32_t i = 0; i < n; )
+	{
+		uint32_t j = i + 1;
+		while (j < n && _pixelScratch[j].y == _pixelScratch[i].y && _pixelScratch[j].x == _pixelScratch[j - 1].x + 1) j++;
+		uint16_t x = _pixelScratch[i].x, y = _pixelScratch[i].y;
+		if ((x & 0xFF) != (curX & 0xFF)) writeReg(RA8875_CURH0, x & 0xFF);
+		if ((x >> 8) != (curX >> 8)) writeReg(RA8875_CURH1, x >> 8);
+		if ((y & 0xFF) != (curY & 0xFF)) writeReg(RA8875_CURV0, y & 0xFF);
+		if ((y >> 8) != (curY >> 8)) writeReg(RA8875_CURV1, y >> 8);
+		curX = x + (j - i);
+		curY = y;
+		if (curX >= _width)
+		{
+			curX = 0;
+			curY++;
+		}
+		_byteScratch.resize((j - i) * 2);
+		for (uint32_t k = i; k < j; k++)
+		{
+			_byteScratch[(k - i) * 2] = _pixelScratch[k].color >> 8;
+			_byteScratch[(k - i) * 2 + 1] = _pixelScratch[k].color & 0xFF;
+		}
+		writeCommand(RA8875_MRWC);
+		writeData(&_byteScratch[0], _byteScratch.size());
+		i = j;
+	}
+	endPrimitive();
+}
+
+// Sends a rectangle of the host buffer. Rows are converted into the staging
+// buffer and written whenever it fills up. Does nothing without a host buffer
+// or when the rectangle is not on screen.
+void RA8875::writeHostRect(int16_t left, int16_t top, int16_t right, int16_t bottom)
+{
+	if (_hostBuffer == NULL) return;
+	if (left < 0 || top < 0 || left > right || top > bottom || right >= (int16_t)_width || bottom >= (int16_t)_height) return;
+	uint32_t w = right - left + 1;
+	_byteScratch.resize(RA8875_STAGING_PIXELS * 2);
+	uint32_t used = 0;
+	beginPrimitive();
+	setActiveWindow(left, top, right, bottom);
+	writeCommand(RA8875_MRWC);
+	for (int16_t y = top; y <= bottom; y++)
+	{
+		const uint16_t* in = _hostBuffer + y * _width + left;
+		for (uint32_t x = 0; x < w; )
+		{
+			uint32_t n = w - x < RA8875_STAGING_PIXELS - used ? w - x : RA8875_STAGING_PIXELS - used;
+			convertPixels(&_byteScratch[used * 2], in + x, n, PIXEL_RGB565);
+			used += n;
+			x += n;
+			if (used < RA8875_STAGING_PIXELS) continue;
+			writeData(&_byteScratch[0], used * 2);
+			used = 0;
+		}
+	}
+	if (used) writeData(&_byteScratch[0], used * 2);
+	endPrimitive();
+}
+
+void RA8875::drawImage(const uint16_t *addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	drawImage(addr, PIXEL_RGB565, x, y, w, h);
 }
 
-void RA8875::drawImage(uint16_t *addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+// The pixels are converted RA8875_STAGING_PIXELS at a time, each batch going
+// out as its own data write, so no copy of the whole image is ever made
+void RA8875::drawImage(const void* addr, PixelFormatEnum format, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
+	const uint8_t* in = (const uint8_t*)addr;
+	uint32_t count = w * h, size = pixelFormatSize(format);
+	_byteScratch.resize(RA8875_STAGING_PIXELS * 2);
+	waitEngine();
+	beginPrimitive();
 	setActiveWindow(x, y, x + w - 1, y + h-1);
 	writeCommand(RA8875_MRWC);
-	writeData((uint8_t*)addr, w*h << 1);
+	if (format == PIXEL_RGB565_BUS)
+	{
+		writeData(in, count << 1);
+		endPrimitive();
+		return;
+	}
+	for (uint32_t done = 0; done < count; )
+	{
+		uint32_t n = count - done < RA8875_STAGING_PIXELS ? count - done : RA8875_STAGING_PIXELS;
+		convertPixels(&_byteScratch[0], in + done * size, n, format);
+		writeData(&_byteScratch[0], n * 2);
+		done += n;
+	}
+	endPrimitive();
+}
+
+// Double buffered uploads: the I/O thread streams one image buffer while the
+// caller fills the other. Any synchronous call waits for queued uploads first.
+bool RA8875::startAsync(uint32_t maxPixels)
+{
+	return _spi->startAsync(maxPixels << 1);
+}
+
+void RA8875::stopAsync()
+{
+	_spi->stopAsync();
+}
+
+uint16_t* RA8875::acquireImageBuffer()
+{
+	return (uint16_t*)_spi->acquireStaging();
+}
+
+SPIFence RA8875::drawImageAsync(const uint16_t* addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	return drawImageAsync(addr, PIXEL_RGB565, x, y, w, h);
+}
+
+// A buffer from acquireImageBuffer() is converted in place and queued as is,
+// bus order pixels are queued by reference and must stay until the fence.
+// Any other image is converted into the staging buffers a buffer at a time,
+// so the I/O thread sends one part while the next one is being converted.
+// Buffers the caller holds from acquireImageBuffer() are left alone; when it
+// holds all of them, or an image in a staging buffer runs past its end, the
+// image goes out synchronously.
+SPIFence RA8875::drawImageAsync(const void* addr, PixelFormatEnum format, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	const uint8_t* in = (const uint8_t*)addr;
+	uint32_t count = w * h, size = pixelFormatSize(format);
+	bool staged = _spi->isStaging(in);
+	bool inPlace = staged ? _spi->isStaging(in, count * size) : format == PIXEL_RGB565_BUS;
+	uint8_t* staging = NULL;
+	if (_spi->isAsync() && !inPlace && !staged) staging = _spi->acquireStaging();
+	if (!_spi->isAsync() || (!inPlace && staging == NULL))
+	{
+		drawImage(addr, format, x, y, w, h);
+		if (staged) _spi->releaseStaging(in);
+		return 0;
+	}
+	flushRegs();
+	waitEngine();
+	_batchDepth++;
+	setActiveWindow(x, y, x + w - 1, y + h - 1);
+	writeCommand(RA8875_MRWC);
+	_batchDepth--;
+	SPIFence fence = 0;
+	if (inPlace)
+	{
+		convertPixels((uint8_t*)in, in, count, format);
+		fence = _spi->submitAsync(_tx, RA8875_DATAWRITE, in, count << 1);
+		_tx.clear();
+		return fence;
+	}
+	uint32_t chunk = _spi->stagingSize() >> 1;
+	for (uint32_t done = 0; done < count; )
+	{
+		uint32_t n = count - done < chunk ? count - done : chunk;
+		if (staging == NULL) staging = _spi->acquireStaging();
+		convertPixels(staging, in + done * size, n, format);
+		fence = _spi->submitAsync(_tx, RA8875_DATAWRITE, staging, n << 1);
+		_tx.clear();
+		staging = NULL;
+		done += n;
+	}
+	return fence;
+}
+
+// One DCR line. Coordinate bytes that match the previous segment are skipped by
+// the shadow copy, so along a polyline mostly the start and the changed end
+// bytes go out.
+void RA8875::lineSegment(const RA8875Point& from, const RA8875Point& to)
+{
+	writeReg16(RA8875_DLHSR0, from.x);
+	writeReg16(RA8875_DLVSR0, from.y);
+	writeReg16(RA8875_DLHER0, to.x);
+	writeReg16(RA8875_DLVER0, to.y);
+	/* Coordinates are staged while the previous segment still runs */
+	waitEngine();
+	writeReg(RA8875_DCR, RA8875_DCR_LINESQUTRI_START | RA8875_DCR_DRAWLINE);
+	engineStarted(RA8875_DCR, RA8875_DCR_LINESQUTRI_STATUS);
+}
+
+void RA8875::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+	RA8875Point points[2] = { { x0, y0 }, { x1, y1 } };
+	drawPolyline(points, 2, color);
+}
+
+// Connected segments through count points, the color is written once
+void RA8875::drawPolyline(const RA8875Point* points, uint32_t count, uint16_t color)
+{
+	if (count < 2) return;
+	beginPrimitive();
+	waitEngine();
+	setForeColor(color);
+	for (uint32_t i = 1; i < count; i++) lineSegment(points[i - 1], points[i]);
+	endPrimitive();
+}
+
+// Separate segments from consecutive pairs of points
+void RA8875::drawLines(const RA8875Point* points, uint32_t count, uint16_t color)
+{
+	if (count < 2) return;
+	beginPrimitive();
+	waitEngine();
+	setForeColor(color);
+	for (uint32_t i = 1; i < count; i += 2) lineSegment(points[i - 1], points[i]);
+	endPrimitive();
+}
+
+// Draws a list of primitives. Batched, the register writes for an item are
+// staged while the engine still draws the one before, and the shadow copy
+// drops every register byte (coordinates, color) equal to the previous item's.
+// With batched = false each item goes through the blocking per-call path, so
+// both can be compared with getPrimitivesPerSecond().
+void RA8875::drawPrimitives(const RA8875Primitive* items, uint32_t count, uint16_t color, bool batched)
+{
+	uint32_t start = micros();
+	bool pipelined = _pipelined;
+	if (!batched) flush();
+	_pipelined = batched;
+	if (batched) beginPrimitive();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const RA8875Primitive& p = items[i];
+		uint16_t c = p.hasColor ? p.color : color;
+		switch (p.type)
+		{
+		case PrimRect:
+		case PrimFilledRect:
+			rectHelper(p.x0, p.y0, p.x1, p.y1, c, p.type == PrimFilledRect);
+			break;
+		case PrimCircle:
+		case PrimFilledCircle:
+			circleHelper(p.x0, p.y0, p.x1, c, p.type == PrimFilledCircle);
+			break;
+		case PrimLine:
+			drawLine(p.x0, p.y0, p.x1, p.y1, c);
+			break;
+		case PrimPoint:
+			// A one pixel square keeps points on the engine, no window or cursor changes
+			rectHelper(p.x0, p.y0, p.x0, p.y0, c, true);
+			break;
+		}
+	}
+	if (batched) endPrimitive();
+	flush();
+	_pipelined = pipelined;
+	_batchStats.lists++;
+	_batchStats.primitives += count;
+	_batchStats.micros += micros() - start;
+}
+
+uint32_t RA8875::getPrimitivesPerSecond() const
+{
+	if (_batchStats.micros == 0) return 0;
+	return (uint32_t)(_batchStats.primitives * 1000000ULL / _batchStats.micros);
+}
+
+void RA8875::resetBatchStats()
+{
+	memset(&_batchStats, 0, sizeof(_batchStats));
 }
 
 void RA8875::rectHelper(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool filled)
 {
+	beginPrimitive();
 	/* Set X */
 	writeReg16(RA8875_DLHSR0, x);
 	/* Set Y */
@@ -455,10 +1231,11 @@ void RA8875::rectHelper(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t col
 	/* Set Y1 */
 	writeReg16(RA8875_DLVER0, h);
 	
+	/* Coordinates are staged while the previous primitive still runs */
+	waitEngine();
+
 	/* Set Color */
-	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (color & 0x001f));
+	setForeColor(color);
 
 	/* Draw! */
 	writeCommand(RA8875_DCR);
@@ -471,12 +1248,13 @@ void RA8875::rectHelper(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t col
 		writeData(RA8875_DCR_LINESQUTRI_START | RA8875_DCR_DRAWSQUARE);
 	}
 
-	/* Wait for the command to finish */
-	waitPoll(RA8875_DCR, RA8875_DCR_LINESQUTRI_STATUS);
+	endPrimitive();
+	engineStarted(RA8875_DCR, RA8875_DCR_LINESQUTRI_STATUS);
 }
 
 void RA8875::circleHelper(int16_t x0, int16_t y0, int16_t r, uint16_t color, bool filled)
 {
+	beginPrimitive();
 	/* Set X */
 	writeReg16(RA8875_DCHR0, x0);
 	/* Set Y */
@@ -485,10 +1263,11 @@ void RA8875::circleHelper(int16_t x0, int16_t y0, int16_t r, uint16_t color, boo
 	/* Set Radius */
 	writeReg(RA8875_DCRR, r);
 
+	/* Coordinates are staged while the previous primitive still runs */
+	waitEngine();
+
 	/* Set Color */
-	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (color & 0x001f));
+	setForeColor(color);
 
 	/* Draw! */
 	writeCommand(RA8875_DCR);
@@ -501,12 +1280,13 @@ void RA8875::circleHelper(int16_t x0, int16_t y0, int16_t r, uint16_t color, boo
 		writeData(RA8875_DCR_CIRCLE_START | RA8875_DCR_NOFILL);
 	}
 
-	/* Wait for the command to finish */
-	waitPoll(RA8875_DCR, RA8875_DCR_CIRCLE_STATUS);
+	endPrimitive();
+	engineStarted(RA8875_DCR, RA8875_DCR_CIRCLE_STATUS);
 }
 
 void RA8875::ellipseHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int16_t shortAxis, uint16_t color, bool filled)
 {
+	beginPrimitive();
 	/* Set Center Point */
 	writeReg16(RA8875_DEHR0, xCenter);
 	writeReg16(RA8875_DEVR0, yCenter);
@@ -515,10 +1295,11 @@ void RA8875::ellipseHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, i
 	writeReg16(RA8875_ELL_A0, longAxis);
 	writeReg16(RA8875_ELL_B0, shortAxis);
 
+	/* Coordinates are staged while the previous primitive still runs */
+	waitEngine();
+
 	/* Set Color */
-	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (color & 0x001f));
+	setForeColor(color);
 
 	/* Draw! */
 	writeCommand(RA8875_ELLIPSE);
@@ -531,12 +1312,13 @@ void RA8875::ellipseHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, i
 		writeData(RA8875_DCR_LINESQUTRI_START);
 	}
 
-	/* Wait for the command to finish */
-	waitPoll(RA8875_ELLIPSE, RA8875_ELLIPSE_STATUS);
+	endPrimitive();
+	engineStarted(RA8875_ELLIPSE, RA8875_ELLIPSE_STATUS);
 }
 
 void RA8875::triangleHelper(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color, bool filled)
 {
+	beginPrimitive();
 	/* Set Point 0 */
 	writeReg16(RA8875_DLHSR0, x0);
 	writeReg16(RA8875_DLVSR0, y0);
@@ -549,10 +1331,11 @@ void RA8875::triangleHelper(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int1
 	writeReg16(RA8875_DTPH0, x2);
 	writeReg16(RA8875_DTPV0, y2);
 
+	/* Coordinates are staged while the previous primitive still runs */
+	waitEngine();
+
 	/* Set Color */
-	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (color & 0x001f));
+	setForeColor(color);
 
 	/* Draw! */
 	writeCommand(RA8875_DCR);
@@ -565,12 +1348,13 @@ void RA8875::triangleHelper(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int1
 		writeData(RA8875_DCR_LINESQUTRI_START | RA8875_DCR_DRAWTRIANGLE | RA8875_DCR_NOFILL);
 	}
 
-	/* Wait for the command to finish */
-	waitPoll(RA8875_DCR, RA8875_DCR_LINESQUTRI_STATUS);
+	endPrimitive();
+	engineStarted(RA8875_DCR, RA8875_DCR_LINESQUTRI_STATUS);
 }
 
 void RA8875::curveHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int16_t shortAxis, uint8_t curvePart, uint16_t color, bool filled)
 {
+	beginPrimitive();
 	/* Set Center Point */
 	writeReg16(RA8875_DEHR0, xCenter);
 	writeReg16(RA8875_DEVR0, yCenter);
@@ -579,10 +1363,11 @@ void RA8875::curveHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int
 	writeReg16(RA8875_ELL_A0, longAxis);
 	writeReg16(RA8875_ELL_B0, shortAxis);
 
+	/* Coordinates are staged while the previous primitive still runs */
+	waitEngine();
+
 	/* Set Color */
-	writeReg(RA8875_FGCR0, (color & 0xf800) >> 11);
-	writeReg(RA8875_FGCR1, (color & 0x07e0) >> 5);
-	writeReg(RA8875_FGCR2, (color & 0x001f));
+	setForeColor(color);
 
 	/* Draw! */
 	writeCommand(RA8875_ELLIPSE);
@@ -595,8 +1380,8 @@ void RA8875::curveHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int
 		writeData(0x90 | (curvePart & 0x03));
 	}
 
-	/* Wait for the command to finish */
-	waitPoll(RA8875_ELLIPSE, RA8875_ELLIPSE_STATUS);
+	endPrimitive();
+	engineStarted(RA8875_ELLIPSE, RA8875_ELLIPSE_STATUS);
 }
 
 void RA8875::fillScreen(uint16_t color)
@@ -604,6 +1389,77 @@ void RA8875::fillScreen(uint16_t color)
 	rectHelper(0, 0, _width - 1, _height - 1, color, 1);
 }
 
+// Copies a block within the layer currently written to
+void RA8875::copyRect(int16_t srcX, int16_t srcY, int16_t w, int16_t h, int16_t dstX, int16_t dstY, RA8875RopEnum rop)
+{
+	RA8875MemoryEnum layer = getLayer();
+	copyRect(layer, srcX, srcY, w, h, layer, dstX, dstY, rop);
+}
+
+// Block copy through the BTE: about 20 register bytes however large the block.
+// The destination is combined with the source through rop. When source and
+// destination share a layer and the destination lies further on in scan order,
+// the move runs backwards from the bottom right corner, so overlapping source
+// pixels are read before they are overwritten.
+void RA8875::copyRect(RA8875MemoryEnum srcLayer, int16_t srcX, int16_t srcY, int16_t w, int16_t h,
+	RA8875MemoryEnum dstLayer, int16_t dstX, int16_t dstY, RA8875RopEnum rop)
+{
+	if (w <= 0 || h <= 0) return;
+	bool negative = srcLayer == dstLayer && (dstY > srcY || (dstY == srcY && dstX > srcX));
+	if (negative)
+	{
+		srcX += w - 1;
+		srcY += h - 1;
+		dstX += w - 1;
+		dstY += h - 1;
+	}
+	/* BTE registers must not change under a running BTE */
+	waitEngine();
+	beginPrimitive();
+	writeReg16(RA8875_HSBE0, srcX);
+	writeReg16(RA8875_VSBE0, srcY | (srcLayer == Layer2 ? RA8875_BTE_LAYER2 << 8 : 0));
+	writeReg16(RA8875_HDBE0, dstX);
+	writeReg16(RA8875_VDBE0, dstY | (dstLayer == Layer2 ? RA8875_BTE_LAYER2 << 8 : 0));
+	writeReg16(RA8875_BEWR0, w);
+	writeReg16(RA8875_BEHR0, h);
+	writeReg(RA8875_BECR1, (rop << 4) | (negative ? RA8875_BECR1_MOVE_NEGATIVE : RA8875_BECR1_MOVE_POSITIVE));
+	writeReg(RA8875_BECR0, RA8875_BECR0_ENABLE);
+	endPrimitive();
+	engineStarted(RA8875_BECR0, RA8875_BECR0_ENABLE, RA8875_INTC2_BTE);
+}
+
+// Shifts a block by dx, dy on the current layer. The uncovered part keeps its
+// old content.
+void RA8875::moveRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy)
+{
+	copyRect(x, y, w, h, x + dx, y + dy);
+}
+
+// Monochrome bitmap through BTE color expansion: one bit per pixel on the wire
+// instead of 16. Rows start on a byte boundary and the MSB is the leftmost
+// pixel. Set bits are drawn in fg, clear bits in bg, or left alone when
+// transparent.
+void RA8875::drawBitmap1bpp(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t* bits, uint16_t fg, uint16_t bg, bool transparent)
+{
+	if (w <= 0 || h <= 0) return;
+	waitEngine();
+	beginPrimitive();
+	uint16_t layer = (shadowReg(RA8875_MWCR1) & 0x01) ? RA8875_BTE_LAYER2 << 8 : 0;
+	writeReg16(RA8875_HDBE0, x);
+	writeReg16(RA8875_VDBE0, y | layer);
+	writeReg16(RA8875_BEWR0, w);
+	writeReg16(RA8875_BEHR0, h);
+	/* ROP bits 2-0 select the bit each byte starts with, 7 = MSB */
+	writeReg(RA8875_BECR1, (7 << 4) | (transparent ? RA8875_BECR1_COLOR_EXPAND_TRANSPARENT : RA8875_BECR1_COLOR_EXPAND));
+	setForeColor(fg);
+	if (!transparent) setBackColor(bg);
+	writeReg(RA8875_BECR0, RA8875_BECR0_ENABLE);
+	writeCommand(RA8875_MRWC);
+	writeData(bits, ((w + 7) >> 3) * h);
+	endPrimitive();
+	engineStarted(RA8875_BECR0, RA8875_BECR0_ENABLE, RA8875_INTC2_BTE);
+}
+
 void RA8875::displayOn(bool on)
 {
 	writeReg(RA8875_PWRR, RA8875_PWRR_NORMAL | (on ? RA8875_PWRR_DISPON : RA8875_PWRR_DISPOFF));
@@ -660,12 +1516,12 @@ void RA8875::touchEnable(bool on)
 			RA8875_TPCR1_DEBOUNCE
 			);
 		/* Enable TP INT */
-		writeReg(RA8875_INTC1, readReg(RA8875_INTC1) | RA8875_INTC1_TP);
+		writeReg(RA8875_INTC1, shadowReg(RA8875_INTC1) | RA8875_INTC1_TP);
 	}
 	else
 	{
 		/* Disable TP INT */
-		writeReg(RA8875_INTC1, readReg(RA8875_INTC1) & ~RA8875_INTC1_TP);
+		writeReg(RA8875_INTC1, shadowReg(RA8875_INTC1) & ~RA8875_INTC1_TP);
 		/* Disable Touch Panel (Reg 0x70) */
 		writeReg(RA8875_TPCR0, RA8875_TPCR0_DISABLE);
 	}
@@ -686,7 +1542,8 @@ bool RA8875::touchRead(uint16_t *x, uint16_t *y)
 {
 	uint16_t tx, ty;
 	uint8_t temp;
-	_spi->setClockDiv(DEFAULT_LOW_SPI_CLOCK);
+	// INT high means INTC2 has no touch pending, no need to ask over SPI
+	if (_int.isOpen() && _int.level()) return false;
 	bool touched = readReg(RA8875_INTC2) & RA8875_INTC2_TP;
 	if (touched)
 	{
@@ -711,6 +1568,5 @@ bool RA8875::touchRead(uint16_t *x, uint16_t *y)
 		*y = cty;
 	}
 	writeReg(RA8875_INTC2, RA8875_INTC2_TP);
-	_spi->setClockDiv(DEFAULT_HIGH_SPI_CLOCK);
 	return touched;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "SPIdev.h"
+#include "PixelConvert.h"
+#include <vector>
 
 #define RA8875_480x272			0x01
 #define RA8875_800x480			0x02
@@ -10,6 +12,25 @@ enum RA8875ModeEnum { GRAPHIC, TEXT };
 enum RA8875MemoryEnum { Layer1, Layer2, CGRAM, Cursor, Pattern };
 enum RA8875FontSourceEnum { INT_CGRAM, INT_CGROM };
 
+enum RA8875ErrorEnum { NoError, PollTimeout };
+
+#define RA8875_POLL_TIMEOUT_MS		100
+#define RA8875_POLL_SPIN			8       // Polls before backing off
+#define RA8875_POLL_BACKOFF_MIN_US	2
+#define RA8875_POLL_BACKOFF_MAX_US	512
+#define RA8875_RUN_OVERHEAD			11      // Typical bus bytes to start a pixel run: cursor bytes, MRWC, data prefix
+#define RA8875_VSYNC_TIMEOUT_MS		40      // Longer than one frame at any sane refresh rate
+#define RA8875_STAGING_PIXELS		2048    // Pixels converted per bus write, 4 KB matches the spidev bufsiz default
+
+// Engine completion polling counters
+struct RA8875PollStats
+{
+	uint32_t waits;     ///< Completions waited for
+	uint32_t polls;     ///< Status reads while waiting
+	uint32_t sleeps;    ///< Backoff pauses between polls
+	uint32_t timeouts;  ///< Waits given up after the poll timeout
+};
+
 enum RA8875LayerModeEnum
 {
 	OnlyLayer1,         ///< Only layer 1 is visible
@@ -21,6 +42,87 @@ enum RA8875LayerModeEnum
 	FloatingWindow      ///< Floating Window mode
 };
 
+enum RA8875ScrollModeEnum
+{
+	ScrollBothLayers,   ///< Layer 1 and 2 scroll together
+	ScrollLayer1,       ///< Only layer 1 scrolls
+	ScrollLayer2,       ///< Only layer 2 scrolls
+	ScrollBuffer        ///< Layer 2 is used as scroll buffer
+};
+
+struct RA8875Point
+{
+	int16_t x;
+	int16_t y;
+};
+
+enum RA8875PrimitiveEnum
+{
+	PrimRect,           ///< Outline from (x0, y0) to (x1, y1)
+	PrimFilledRect,     ///< Filled from (x0, y0) to (x1, y1)
+	PrimCircle,         ///< Outline around (x0, y0), radius x1
+	PrimFilledCircle,   ///< Filled around (x0, y0), radius x1
+	PrimLine,           ///< From (x0, y0) to (x1, y1)
+	PrimPoint           ///< Single pixel at (x0, y0)
+};
+
+// One entry of a primitive list for drawPrimitives
+struct RA8875Primitive
+{
+	uint8_t type;       ///< RA8875PrimitiveEnum
+	bool hasColor;      ///< Use color below instead of the list color
+	uint16_t color;
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+};
+
+// Glyph pacing measured for one text scale
+struct RA8875TextPacing
+{
+	uint32_t glyphs;        ///< Glyphs written with status polling
+	uint32_t busyPolls;     ///< Status reads that found the glyph still rendering
+	uint32_t maxBusyPolls;  ///< Most busy reads seen for one glyph
+	bool burst;             ///< Strings at this scale are streamed in one transaction, unenlarged text only
+};
+
+// Primitive list throughput
+struct RA8875BatchStats
+{
+	uint32_t lists;       ///< drawPrimitives calls
+	uint32_t primitives;  ///< Primitives drawn by them
+	uint64_t micros;      ///< Time spent in them, until the engine was idle
+};
+
+struct RA8875Pixel
+{
+	int16_t x;
+	int16_t y;
+	uint16_t color;
+};
+
+// BTE raster operations on source (S) and destination (D) pixels
+enum RA8875RopEnum
+{
+	RopBlack,           ///< 0
+	RopNotSAndNotD,     ///< ~S & ~D
+	RopNotSAndD,        ///< ~S & D
+	RopNotS,            ///< ~S
+	RopSAndNotD,        ///< S & ~D
+	RopNotD,            ///< ~D
+	RopSXorD,           ///< S ^ D
+	RopNotSOrNotD,      ///< ~S | ~D
+	RopSAndD,           ///< S & D
+	RopNotSXorD,        ///< ~(S ^ D)
+	RopD,               ///< D, destination unchanged
+	RopNotSOrD,         ///< ~S | D
+	RopS,               ///< S, plain copy
+	RopSOrNotD,         ///< S | ~D
+	RopSOrD,            ///< S | D
+	RopWhite            ///< 1
+};
+
 class RA8875
 {
 public:
@@ -29,14 +131,30 @@ public:
 
 	void hardReset(void);
 	void softReset(void);
+	void syncRegisters();
 	bool initialize(uint8_t mode);
 	void deinitialize();
 	void clearMemory(bool full);
 	void setMode(RA8875ModeEnum mode);
 	void selectMemory(RA8875MemoryEnum memory);
+	RA8875MemoryEnum getLayer();
 	void setLayerMode(RA8875LayerModeEnum mode);
 	void setLayerTransparency(uint8_t layer1, uint8_t layer2);
 	void setActiveWindow(uint32_t left, uint32_t top, uint32_t right, uint32_t bottom);
+	void setScrollWindow(uint16_t left, uint16_t top, uint16_t right, uint16_t bottom);
+	void setScrollMode(RA8875ScrollModeEnum mode);
+	void scrollTo(uint16_t x, uint16_t y);
+	void scroll(int16_t dx, int16_t dy);
+	uint16_t getScrollX();
+	uint16_t getScrollY();
+
+	bool setVsyncPin(uint32_t gpio);
+	void setFrameCopyBack(bool copyBack) { _copyBack = copyBack; }
+	bool hasLayer2();
+	bool beginFrame();
+	void addDamage(int16_t x, int16_t y, int16_t w, int16_t h);
+	bool endFrame(bool vsync = false);
+	RA8875MemoryEnum getFrontLayer() const { return _frontLayer; }
 
 	void setFontSource(RA8875FontSourceEnum source);
 	void uploadUserChar(const uint8_t symbol[], uint8_t address);
@@ -46,9 +164,21 @@ public:
 	void textEnlarge(uint8_t scale);
 	void textWrite(int x, int y, const char *str, ...);
 	void showCursor(bool show, bool blink);
+	const RA8875TextPacing& getTextPacing(uint8_t scale) const { return _textPacing[scale & 3]; }
+	void resetTextPacing();
 	void setCursorBlinkRate(uint8_t rate);
 
 	bool waitPoll(uint8_t regname, uint8_t waitflag);
+	void setPipelined(bool pipelined);
+	bool flush();
+	void setPollTimeout(uint32_t timeoutMs) { _pollTimeoutMs = timeoutMs; }
+	RA8875ErrorEnum getError() const { return _error; }
+	void clearError() { _error = NoError; }
+	const RA8875PollStats& getPollStats() const { return _pollStats; }
+	void resetPollStats();
+	bool setInterruptPin(uint32_t gpio);
+	int getInterruptFd() const { return _int.fd(); }
+	bool waitInterrupt(uint32_t timeoutMs);
 	void displayOn(bool on);
 	void sleep(uint8_t sleep);
 	void PWM1out(uint8_t p);
@@ -58,13 +188,35 @@ public:
 
 	void setXY(uint16_t x, uint16_t y);
 	void drawPixel(int16_t x, int16_t y, uint16_t color);
-	void drawImage(uint16_t* addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	void drawPixels(const RA8875Pixel* pixels, uint32_t count);
+	void setHostBuffer(uint16_t* buffer) { _hostBuffer = buffer; }
+	void writeHostRect(int16_t left, int16_t top, int16_t right, int16_t bottom);
+	void drawImage(const uint16_t* addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	void drawImage(const void* addr, PixelFormatEnum format, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	bool startAsync(uint32_t maxPixels);
+	void stopAsync();
+	uint16_t* acquireImageBuffer();
+	SPIFence drawImageAsync(const uint16_t* addr, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	SPIFence drawImageAsync(const void* addr, PixelFormatEnum format, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	bool waitFence(SPIFence fence, uint32_t timeoutMs = 0) { return _spi->waitFence(fence, timeoutMs); }
 	void rectHelper(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool filled);
 	void circleHelper(int16_t x0, int16_t y0, int16_t r, uint16_t color, bool filled);
 	void ellipseHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int16_t shortAxis, uint16_t color, bool filled);
 	void triangleHelper(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color, bool filled);
 	void curveHelper(int16_t xCenter, int16_t yCenter, int16_t longAxis, int16_t shortAxis, uint8_t curvePart, uint16_t color, bool filled);
 	void fillScreen(uint16_t color);
+	void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+	void drawPolyline(const RA8875Point* points, uint32_t count, uint16_t color);
+	void drawLines(const RA8875Point* points, uint32_t count, uint16_t color);
+	void drawPrimitives(const RA8875Primitive* items, uint32_t count, uint16_t color, bool batched = true);
+	const RA8875BatchStats& getBatchStats() const { return _batchStats; }
+	uint32_t getPrimitivesPerSecond() const;
+	void resetBatchStats();
+	void copyRect(int16_t srcX, int16_t srcY, int16_t w, int16_t h, int16_t dstX, int16_t dstY, RA8875RopEnum rop = RopS);
+	void copyRect(RA8875MemoryEnum srcLayer, int16_t srcX, int16_t srcY, int16_t w, int16_t h,
+		RA8875MemoryEnum dstLayer, int16_t dstX, int16_t dstY, RA8875RopEnum rop = RopS);
+	void moveRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy);
+	void drawBitmap1bpp(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t* bits, uint16_t fg, uint16_t bg, bool transparent = false);
 
 
 	void touchEnable(bool on);
@@ -72,6 +224,9 @@ public:
 
 	uint16_t get_width() { return _width; }
 	uint16_t get_height() { return _height; }
+	const SPIStats& getPrimitiveStats() const { return _primitiveStats; }
+	SPIStats getBusStats() const { return _spi->stats(); }
+	void setTrace(SPISink* trace) { _spi->setTrace(trace); }
 private:
 	uint32_t _resetPin;
 	SPIdev* _spi;
@@ -79,16 +234,59 @@ private:
 	uint16_t _height;
 	uint8_t _textScale;
 	char _textBuffer[256];
+	RA8875TextPacing _textPacing[4];
 	RA8875ModeEnum _mode;
+	SPITransaction _tx;
+	uint8_t _batchDepth;
+	SPIStats _primitiveStart;
+	SPIStats _primitiveStats;
+	uint8_t _cmdReg;
+	uint8_t _shadow[256];
+	bool _shadowValid[256];
+	bool _pipelined;
+	uint8_t _pendingReg;
+	uint8_t _pendingFlag;
+	uint32_t _pollTimeoutMs;
+	RA8875ErrorEnum _error;
+	RA8875PollStats _pollStats;
+	GPIOBackend _int;
+	uint8_t _pendingIrq;
+	GPIOBackend _vsync;
+	RA8875MemoryEnum _frontLayer;
+	bool _copyBack;
+	int16_t _damageLeft;
+	int16_t _damageTop;
+	int16_t _damageRight;
+	int16_t _damageBottom;
+	RA8875BatchStats _batchStats;
+	uint16_t* _hostBuffer;
+	std::vector<RA8875Pixel> _pixelScratch;
+	std::vector<uint8_t> _byteScratch;
 	
+	void queueFrame(uint8_t b0, uint8_t b1);
+	void flushRegs();
+	void beginPrimitive();
+	void endPrimitive();
+	void setForeColor(uint16_t color);
+	void setBackColor(uint16_t color);
+	void lineSegment(const RA8875Point& from, const RA8875Point& to);
+	void engineStarted(uint8_t regname, uint8_t waitflag, uint8_t irq = 0);
+	bool waitEngine();
 	void writeData(uint8_t data);
-	void writeData(uint8_t* data, uint32_t dataSize);
+	void writeData(const uint8_t* data, uint32_t dataSize);
 	void writeCommand(uint8_t cmd);
 	uint8_t readData(void);
 	uint8_t readStatus(void);
 	void writeReg(uint8_t reg, uint8_t val);
 	void writeReg16(uint8_t reg, uint16_t val);
 	uint8_t readReg(uint8_t reg);
+	uint8_t shadowReg(uint8_t reg);
+	uint16_t shadowReg16(uint8_t reg) { return shadowReg(reg) | (shadowReg(reg + 1) << 8); }
 	bool PLLinit(void);
+	void programDisplay(uint8_t mode);
+	// Init only: overwrites the BTE registers, the first pixels of the selected
+	// layer and the cursor position
+	bool calibrateSPIClock();
+	bool spiRoundTrip();
 	bool touched(bool clearIntFlag);
 };
@@ -0,0 +1,204 @@
+#include "ra8875_assets.h"
+#include <string.h>
+
+RA8875AssetCache::RA8875AssetCache(RA8875* tft, RA8875MemoryEnum layer, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	_tft = tft;
+	_layer = layer;
+	_area.x = x;
+	_area.y = y;
+	_area.w = w;
+	_area.h = h;
+	_valid = (layer == Layer1 || (layer == Layer2 && tft->hasLayer2())) && w > 0 && h > 0 &&
+		(uint32_t)x + w <= tft->get_width() && (uint32_t)y + h <= tft->get_height();
+	clear();
+	resetStats();
+}
+
+// Forgets every asset, display RAM is left as it is
+void RA8875AssetCache::clear()
+{
+	_count = 0;
+	_freeCount = 0;
+	_clock = 0;
+	addFree(_area);
+}
+
+void RA8875AssetCache::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+int RA8875AssetCache::find(uint32_t id) const
+{
+	for (uint32_t i = 0; i < _count; i++)
+	{
+		if (_entries[i].id == id) return i;
+	}
+	return -1;
+}
+
+// Writes an asset into the cache, replacing one with the same id. Fails only
+// when it is larger than the whole cache area or the entry table is full of
+// assets that can not be evicted.
+bool RA8875AssetCache::upload(uint32_t id, const uint16_t* pixels, uint16_t w, uint16_t h)
+{
+	if (!_valid || w == 0 || h == 0 || w > _area.w || h > _area.h) return false;
+	evict(id);
+	Rect rect;
+	while (_count == RA8875_ASSET_MAX || !allocate(w, h, &rect))
+	{
+		int victim = leastRecentlyUsed();
+		if (victim < 0) return false;
+		evictAt(victim);
+		_stats.evictions++;
+	}
+	RA8875MemoryEnum current = _tft->getLayer();
+	_tft->selectMemory(_layer);
+	_tft->drawImage(pixels, rect.x, rect.y, w, h);
+	_tft->selectMemory(current);
+	Entry& entry = _entries[_count++];
+	entry.id = id;
+	entry.rect = rect;
+	entry.lastUse = ++_clock;
+	_stats.uploads++;
+	return true;
+}
+
+// Copies a cached asset to x, y on the layer currently drawn to
+bool RA8875AssetCache::draw(uint32_t id, int16_t x, int16_t y, RA8875RopEnum rop)
+{
+	int i = find(id);
+	if (i < 0)
+	{
+		_stats.misses++;
+		return false;
+	}
+	blit(_entries[i], x, y, rop);
+	return true;
+}
+
+// Draws from the cache, uploading the asset on a miss. Assets that can not be
+// cached at all are sent straight to the screen.
+void RA8875AssetCache::draw(uint32_t id, int16_t x, int16_t y, const uint16_t* pixels, uint16_t w, uint16_t h)
+{
+	int i = find(id);
+	if (i < 0)
+	{
+		_stats.misses++;
+		if (!upload(id, pixels, w, h))
+		{
+			_tft->drawImage(pixels, x, y, w, h);
+			return;
+		}
+		i = _count - 1;
+	}
+	blit(_entries[i], x, y, RopS);
+}
+
+void RA8875AssetCache::blit(Entry& entry, int16_t x, int16_t y, RA8875RopEnum rop)
+{
+	entry.lastUse = ++_clock;
+	_tft->copyRect(_layer, entry.rect.x, entry.rect.y, entry.rect.w, entry.rect.h, _tft->getLayer(), x, y, rop);
+	_stats.hits++;
+}
+
+void RA8875AssetCache::evict(uint32_t id)
+{
+	int i = find(id);
+	if (i >= 0) evictAt(i);
+}
+
+void RA8875AssetCache::evictAt(uint32_t index)
+{
+	Rect rect = _entries[index].rect;
+	_entries[index] = _entries[--_count];
+	if (_count == 0)
+	{
+		// Empty again: start over from one free rectangle, whatever got fragmented
+		_freeCount = 0;
+		addFree(_area);
+		return;
+	}
+	release(rect);
+}
+
+int RA8875AssetCache::leastRecentlyUsed() const
+{
+	int victim = -1;
+	for (uint32_t i = 0; i < _count; i++)
+	{
+		if (victim < 0 || _entries[i].lastUse < _entries[victim].lastUse) victim = i;
+	}
+	return victim;
+}
+
+// Best short side fit. The leftover of the chosen rectangle is split in two,
+// the cut running along the longer leftover side so the bigger piece stays whole.
+bool RA8875AssetCache::allocate(uint16_t w, uint16_t h, Rect* rect)
+{
+	int best = -1;
+	uint32_t bestFit = 0xFFFFFFFF;
+	for (uint32_t i = 0; i < _freeCount; i++)
+	{
+		if (_free[i].w < w || _free[i].h < h) continue;
+		uint32_t fit = _free[i].w - w < _free[i].h - h ? _free[i].w - w : _free[i].h - h;
+		if (fit < bestFit)
+		{
+			best = i;
+			bestFit = fit;
+		}
+	}
+	if (best < 0) return false;
+	Rect r = _free[best];
+	_free[best] = _free[--_freeCount];
+	rect->x = r.x;
+	rect->y = r.y;
+	rect->w = w;
+	rect->h = h;
+	Rect right = { (uint16_t)(r.x + w), r.y, (uint16_t)(r.w - w), r.h };
+	Rect bottom = { r.x, (uint16_t)(r.y + h), r.w, (uint16_t)(r.h - h) };
+	if (r.w - w > r.h - h) bottom.w = w;
+	else right.h = h;
+	addFree(right);
+	addFree(bottom);
+	return true;
+}
+
+// Returns a rectangle to the free list, merging neighbours that share a whole edge
+void RA8875AssetCache::release(const Rect& rect)
+{
+	Rect r = rect;
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (uint32_t i = 0; i < _freeCount; i++)
+		{
+			Rect& f = _free[i];
+			if (f.y == r.y && f.h == r.h && (f.x + f.w == r.x || r.x + r.w == f.x))
+			{
+				r.x = f.x < r.x ? f.x : r.x;
+				r.w += f.w;
+			}
+			else if (f.x == r.x && f.w == r.w && (f.y + f.h == r.y || r.y + r.h == f.y))
+			{
+				r.y = f.y < r.y ? f.y : r.y;
+				r.h += f.h;
+			}
+			else continue;
+			_free[i] = _free[--_freeCount];
+			merged = true;
+			break;
+		}
+	}
+	addFree(r);
+}
+
+// A full free list drops the rectangle; the space comes back once the cache
+// runs empty
+void RA8875AssetCache::addFree(const Rect& rect)
+{
+	if (rect.w == 0 || rect.h == 0 || _freeCount == RA8875_ASSET_MAX_FREE) return;
+	_free[_freeCount++] = rect;
+}
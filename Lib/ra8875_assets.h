@@ -0,0 +1,68 @@
+#pragma once
+#include "ra8875.h"
+
+#define RA8875_ASSET_MAX		64
+#define RA8875_ASSET_MAX_FREE	(RA8875_ASSET_MAX * 4)
+
+struct RA8875AssetStats
+{
+	uint32_t hits;       ///< Draws served from display RAM, first draws after an upload included
+	uint32_t misses;     ///< Draws of assets that were not cached
+	uint32_t uploads;    ///< Assets written to the cache
+	uint32_t evictions;  ///< Assets dropped to make room
+};
+
+// Keeps icons, digit sprites and backgrounds in display RAM that is not shown,
+// e.g. layer 2 while only layer 1 is visible. An asset is uploaded once and
+// every later draw is a BTE move of a few register bytes. Free space is a list
+// of rectangles split on allocation and merged again on release; when an asset
+// does not fit, the least recently drawn ones are evicted until it does.
+// Assets are identified by a caller chosen id. The area has to lie in display
+// RAM that exists: layer 2 only when RA8875::hasLayer2(), which is not the case
+// at 800x480 16bpp. Otherwise isValid() is false and every upload fails, so
+// draws with pixels go straight to the screen.
+class RA8875AssetCache
+{
+public:
+	RA8875AssetCache(RA8875* tft, RA8875MemoryEnum layer, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+	bool upload(uint32_t id, const uint16_t* pixels, uint16_t w, uint16_t h);
+	bool isValid() const { return _valid; }
+	bool contains(uint32_t id) const { return find(id) >= 0; }
+	bool draw(uint32_t id, int16_t x, int16_t y, RA8875RopEnum rop = RopS);
+	void draw(uint32_t id, int16_t x, int16_t y, const uint16_t* pixels, uint16_t w, uint16_t h);
+	void evict(uint32_t id);
+	void clear();
+	const RA8875AssetStats& stats() const { return _stats; }
+	void resetStats();
+private:
+	struct Rect
+	{
+		uint16_t x, y, w, h;
+	};
+	struct Entry
+	{
+		uint32_t id;
+		Rect rect;
+		uint32_t lastUse;
+	};
+
+	RA8875* _tft;
+	RA8875MemoryEnum _layer;
+	Rect _area;
+	bool _valid;
+	Entry _entries[RA8875_ASSET_MAX];
+	uint32_t _count;
+	Rect _free[RA8875_ASSET_MAX_FREE];
+	uint32_t _freeCount;
+	uint32_t _clock;
+	RA8875AssetStats _stats;
+
+	int find(uint32_t id) const;
+	void blit(Entry& entry, int16_t x, int16_t y, RA8875RopEnum rop);
+	bool allocate(uint16_t w, uint16_t h, Rect* rect);
+	void release(const Rect& rect);
+	void addFree(const Rect& rect);
+	void evictAt(uint32_t index);
+	int leastRecentlyUsed() const;
+};
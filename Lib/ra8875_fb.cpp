@@ -0,0 +1,215 @@
+#include "ra8875_fb.h"
+#include "TileHash.h"
+#include <string.h>
+
+static uint32_t regionCost(int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+	return RA8875_FB_REGION_OVERHEAD + (uint32_t)(right - left + 1) * (bottom - top + 1) * 2;
+}
+
+RA8875Framebuffer::RA8875Framebuffer(RA8875* tft)
+{
+	_tft = tft;
+	_width = tft->get_width();
+	_height = tft->get_height();
+	_pixels = new uint16_t[_width * _height];
+	memset(_pixels, 0, _width * _height * sizeof(uint16_t));
+	_regionCount = 0;
+	_tilesX = (_width + RA8875_FB_TILE_W - 1) / RA8875_FB_TILE_W;
+	_tilesY = (_height + RA8875_FB_TILE_H - 1) / RA8875_FB_TILE_H;
+	_tileHashes = new uint32_t[_tilesX * _tilesY];
+	_tileHashesValid = false;
+	memset(&_diffStats, 0, sizeof(_diffStats));
+	resetStats();
+	_tft->setHostBuffer(_pixels);
+}
+
+RA8875Framebuffer::~RA8875Framebuffer()
+{
+	_tft->setHostBuffer(NULL);
+	delete[] _tileHashes;
+	delete[] _pixels;
+}
+
+void RA8875Framebuffer::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+// Clips to the screen, false when nothing is left
+bool RA8875Framebuffer::clip(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const
+{
+	if (x < 0)
+	{
+		w += x;
+		x = 0;
+	}
+	if (y < 0)
+	{
+		h += y;
+		y = 0;
+	}
+	if (x + w > _width) w = _width - x;
+	if (y + h > _height) h = _height - y;
+	return w > 0 && h > 0;
+}
+
+void RA8875Framebuffer::markDirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	if (!clip(x, y, w, h)) return;
+	Region r = { x, y, (int16_t)(x + w - 1), (int16_t)(y + h - 1) };
+	addRegion(r);
+}
+
+// Folds r into every region it is cheaper to send together with, then keeps
+// it. A full list takes r into the region that grows the least.
+void RA8875Framebuffer::addRegion(Region r)
+{
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (uint32_t i = 0; i < _regionCount; i++)
+		{
+			Region& e = _regions[i];
+			int16_t left = e.left < r.left ? e.left : r.left;
+			int16_t top = e.top < r.top ? e.top : r.top;
+			int16_t right = e.right > r.right ? e.right : r.right;
+			int16_t bottom = e.bottom > r.bottom ? e.bottom : r.bottom;
+			if (regionCost(left, top, right, bottom) > regionCost(e.left, e.top, e.right, e.bottom) + regionCost(r.left, r.top, r.right, r.bottom)) continue;
+			r.left = left;
+			r.top = top;
+			r.right = right;
+			r.bottom = bottom;
+			_regions[i] = _regions[--_regionCount];
+			merged = true;
+			break;
+		}
+	}
+	if (_regionCount < RA8875_FB_MAX_REGIONS)
+	{
+		_regions[_regionCount++] = r;
+		return;
+	}
+	uint32_t best = 0, bestGrowth = 0xFFFFFFFF;
+	for (uint32_t i = 0; i < _regionCount; i++)
+	{
+		Region& e = _regions[i];
+		uint32_t growth = regionCost(e.left < r.left ? e.left : r.left, e.top < r.top ? e.top : r.top,
+			e.right > r.right ? e.right : r.right, e.bottom > r.bottom ? e.bottom : r.bottom) - regionCost(e.left, e.top, e.right, e.bottom);
+		if (growth < bestGrowth)
+		{
+			best = i;
+			bestGrowth = growth;
+		}
+	}
+	Region e = _regions[best];
+	_regions[best] = _regions[--_regionCount];
+	r.left = e.left < r.left ? e.left : r.left;
+	r.top = e.top < r.top ? e.top : r.top;
+	r.right = e.right > r.right ? e.right : r.right;
+	r.bottom = e.bottom > r.bottom ? e.bottom : r.bottom;
+	addRegion(r);
+}
+
+void RA8875Framebuffer::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	if (!clip(x, y, w, h)) return;
+	for (int16_t j = 0; j < h; j++)
+	{
+		uint16_t* row = _pixels + (y + j) * _width + x;
+		for (int16_t i = 0; i < w; i++) row[i] = color;
+	}
+	markDirty(x, y, w, h);
+}
+
+void RA8875Framebuffer::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+	if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+	_pixels[y * _width + x] = color;
+	markDirty(x, y, 1, 1);
+}
+
+void RA8875Framebuffer::drawImage(const uint16_t* image, int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clip(cx, cy, cw, ch)) return;
+	for (int16_t j = 0; j < ch; j++)
+	{
+		memcpy(_pixels + (cy + j) * _width + cx, image + (cy - y + j) * w + (cx - x), cw * sizeof(uint16_t));
+	}
+	markDirty(cx, cy, cw, ch);
+}
+
+// Sends the dirty regions and returns the number of pixels sent
+uint32_t RA8875Framebuffer::flush()
+{
+	if (_regionCount == 0) return 0;
+	uint32_t pixels = 0;
+	for (uint32_t i = 0; i < _regionCount; i++)
+	{
+		Region& r = _regions[i];
+		_tft->writeHostRect(r.left, r.top, r.right, r.bottom);
+		pixels += (r.right - r.left + 1) * (r.bottom - r.top + 1);
+	}
+	_stats.flushes++;
+	_stats.regions += _regionCount;
+	_stats.pixels += pixels;
+	_regionCount = 0;
+	return pixels;
+}
+
+// Sends the tiles that changed since the last call and returns the number of
+// pixels sent. The first call sends everything. Pending dirty regions are
+// covered by the tile compare and dropped.
+uint32_t RA8875Framebuffer::flushChanged()
+{
+	SPIStats before = _tft->getBusStats();
+	uint32_t pixels = 0;
+	_diffStats.tiles = _tilesX * _tilesY;
+	_diffStats.changedTiles = 0;
+	_diffStats.spans = 0;
+	_diffStats.frameBytes = _width * _height * 2;
+	for (uint16_t ty = 0; ty < _tilesY; ty++)
+	{
+		int16_t top = ty * RA8875_FB_TILE_H;
+		int16_t h = _height - top < RA8875_FB_TILE_H ? _height - top : RA8875_FB_TILE_H;
+		int16_t spanStart = -1;
+		for (uint16_t tx = 0; tx <= _tilesX; tx++)
+		{
+			bool changed = false;
+			if (tx < _tilesX)
+			{
+				int16_t left = tx * RA8875_FB_TILE_W;
+				int16_t w = _width - left < RA8875_FB_TILE_W ? _width - left : RA8875_FB_TILE_W;
+				uint32_t& slot = _tileHashes[ty * _tilesX + tx];
+				uint32_t hash = tileHash(_pixels + top * _width + left, _width, w, h);
+				changed = !_tileHashesValid || hash != slot;
+				slot = hash;
+			}
+			if (changed)
+			{
+				_diffStats.changedTiles++;
+				if (spanStart < 0) spanStart = tx * RA8875_FB_TILE_W;
+				continue;
+			}
+			if (spanStart < 0) continue;
+			int16_t right = tx * RA8875_FB_TILE_W;
+			if (right > _width) right = _width;
+			_tft->writeHostRect(spanStart, top, right - 1, top + h - 1);
+			pixels += (right - spanStart) * h;
+			_diffStats.spans++;
+			spanStart = -1;
+		}
+	}
+	_tileHashesValid = true;
+	_regionCount = 0;
+	_diffStats.bytes = _tft->getBusStats().bytes - before.bytes;
+	if (_diffStats.spans)
+	{
+		_stats.flushes++;
+		_stats.regions += _diffStats.spans;
+		_stats.pixels += pixels;
+	}
+	return pixels;
+}
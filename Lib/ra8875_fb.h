@@ -0,0 +1,84 @@
+#pragma once
+#include "ra8875.h"
+
+#define RA8875_FB_MAX_REGIONS		32
+#define RA8875_FB_REGION_OVERHEAD	32      // Typical bus bytes to open a region: changed window bytes, cursor, MRWC, data prefix
+#define RA8875_FB_TILE_W			32
+#define RA8875_FB_TILE_H			16
+
+struct RA8875FramebufferStats
+{
+	uint32_t flushes;   ///< flush() calls that sent anything
+	uint32_t regions;   ///< Regions sent
+	uint64_t pixels;    ///< Pixels sent, dirty or merged in
+};
+
+// Result of the last flushChanged() frame
+struct RA8875FrameDiffStats
+{
+	uint32_t tiles;         ///< Tiles in the frame
+	uint32_t changedTiles;  ///< Tiles whose hash differed from the previous frame
+	uint32_t spans;         ///< Runs of changed tiles sent as one window
+	uint32_t bytes;         ///< Bus bytes the frame took, commands included
+	uint32_t frameBytes;    ///< Pixel bytes of a full frame upload
+
+	uint32_t tilesSkipped() const { return tiles ? (tiles - changedTiles) * 100 / tiles : 0; }
+	uint32_t bytesSkipped() const { return frameBytes > bytes ? (frameBytes - bytes) * 100ULL / frameBytes : 0; }
+};
+
+// Host side RGB565 copy of the screen. Drawing goes to the copy and marks the
+// touched area dirty; flush() sends the dirty regions through active window +
+// MRWC bursts. Overlapping or nearby regions are merged whenever the union
+// costs fewer bus bytes than sending both, counting RA8875_FB_REGION_OVERHEAD
+// per region and two bytes per pixel. The buffer is also handed to the
+// driver as its host buffer, so RA8875::drawPixels keeps it current.
+//
+// flushChanged() is the alternative for code that redraws the whole buffer
+// each frame without marking anything: the screen is split into
+// RA8875_FB_TILE_W x RA8875_FB_TILE_H tiles, each tile is hashed and compared
+// with the previous frame, and horizontal runs of changed tiles are sent as
+// one span each.
+class RA8875Framebuffer
+{
+public:
+	RA8875Framebuffer(RA8875* tft);
+	~RA8875Framebuffer();
+
+	uint16_t width() const { return _width; }
+	uint16_t height() const { return _height; }
+	uint16_t* pixels() { return _pixels; }
+	void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+	void markAllDirty() { markDirty(0, 0, _width, _height); }
+
+	void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+	void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+	void drawPixel(int16_t x, int16_t y, uint16_t color);
+	void drawImage(const uint16_t* image, int16_t x, int16_t y, int16_t w, int16_t h);
+
+	uint32_t flush();
+	uint32_t flushChanged();
+	const RA8875FramebufferStats& stats() const { return _stats; }
+	const RA8875FrameDiffStats& frameDiffStats() const { return _diffStats; }
+	void resetStats();
+private:
+	struct Region
+	{
+		int16_t left, top, right, bottom;
+	};
+
+	RA8875* _tft;
+	uint16_t _width;
+	uint16_t _height;
+	uint16_t* _pixels;
+	Region _regions[RA8875_FB_MAX_REGIONS];
+	uint32_t _regionCount;
+	RA8875FramebufferStats _stats;
+	uint16_t _tilesX;
+	uint16_t _tilesY;
+	uint32_t* _tileHashes;          ///< Hash of each tile as last sent
+	bool _tileHashesValid;          ///< False until the first flushChanged()
+	RA8875FrameDiffStats _diffStats;
+
+	bool clip(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+	void addRegion(Region r);
+};
@@ -0,0 +1,231 @@
+#include "ra8875_image.h"
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <png.h>
+
+static const uint8_t bayer4[4][4] =
+{
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 }
+};
+
+// libjpeg calls exit() on errors unless error_exit jumps back out
+struct JpegError
+{
+	struct jpeg_error_mgr mgr;
+	jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo)
+{
+	longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+struct PngMemory
+{
+	const uint8_t* data;
+	uint32_t size;
+	uint32_t pos;
+};
+
+static void pngReadMemory(png_structp png, png_bytep out, png_size_t length)
+{
+	PngMemory* mem = (PngMemory*)png_get_io_ptr(png);
+	if (length > mem->size - mem->pos) png_error(png, "truncated image");
+	memcpy(out, mem->data + mem->pos, length);
+	mem->pos += length;
+}
+
+RA8875ImageDecoder::RA8875ImageDecoder(RA8875* tft)
+{
+	_tft = tft;
+	_dither = false;
+	_band = NULL;
+	_bandSize = 0;
+	resetStats();
+}
+
+RA8875ImageDecoder::~RA8875ImageDecoder()
+{
+	delete[] _band;
+}
+
+void RA8875ImageDecoder::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+// The band buffer is kept between images and only grows
+uint8_t* RA8875ImageDecoder::bandBuffer(uint32_t size)
+{
+	if (size > _bandSize)
+	{
+		delete[] _band;
+		_band = new uint8_t[size];
+		_bandSize = size;
+		if (size > _stats.bufferBytes) _stats.bufferBytes = size;
+	}
+	return _band;
+}
+
+// Clips the RGB888 band to the screen by packing the visible part of every row
+// to the front of the buffer, dithers it and queues it
+void RA8875ImageDecoder::sendBand(uint8_t* rgb, int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+	_stats.rows += h;
+	int32_t left = x < 0 ? -x : 0, top = y < 0 ? -y : 0;
+	int32_t right = x + w > _tft->get_width() ? _tft->get_width() - x : w;
+	int32_t bottom = y + h > _tft->get_height() ? _tft->get_height() - y : h;
+	if (left >= right || top >= bottom) return;
+	uint32_t visible = right - left;
+	uint8_t* out = rgb;
+	for (int32_t row = top; row < bottom; row++)
+	{
+		const uint8_t* in = rgb + (row * w + left) * 3;
+		if (out != in) memmove(out, in, visible * 3);
+		if (_dither)
+		{
+			const uint8_t* d = bayer4[(y + row) & 3];
+			for (uint32_t i = 0; i < visible; i++)
+			{
+				uint8_t t = d[(x + left + i) & 3];
+				uint8_t* p = out + i * 3;
+				p[0] = p[0] > 255 - (t >> 1) ? 255 : p[0] + (t >> 1);
+				p[1] = p[1] > 255 - (t >> 2) ? 255 : p[1] + (t >> 2);
+				p[2] = p[2] > 255 - (t >> 1) ? 255 : p[2] + (t >> 1);
+			}
+		}
+		out += visible * 3;
+	}
+	_tft->drawImageAsync(rgb, PIXEL_RGB888, x + left, y + top, visible, bottom - top);
+	_stats.bands++;
+}
+
+bool RA8875ImageDecoder::drawFile(const char* path, int16_t x, int16_t y)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) return false;
+	uint8_t magic[4] = { 0 };
+	size_t n = fread(magic, 1, sizeof(magic), f);
+	rewind(f);
+	bool r = false;
+	if (n >= 2 && magic[0] == 0xFF && magic[1] == 0xD8) r = decodeJpeg(f, NULL, 0, x, y);
+	else if (n == 4 && magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G') r = decodePng(f, NULL, 0, x, y);
+	fclose(f);
+	return r;
+}
+
+bool RA8875ImageDecoder::drawJpeg(const char* path, int16_t x, int16_t y)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) return false;
+	bool r = decodeJpeg(f, NULL, 0, x, y);
+	fclose(f);
+	return r;
+}
+
+bool RA8875ImageDecoder::drawJpeg(const uint8_t* data, uint32_t size, int16_t x, int16_t y)
+{
+	return decodeJpeg(NULL, data, size, x, y);
+}
+
+bool RA8875ImageDecoder::drawPng(const char* path, int16_t x, int16_t y)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) return false;
+	bool r = decodePng(f, NULL, 0, x, y);
+	fclose(f);
+	return r;
+}
+
+bool RA8875ImageDecoder::drawPng(const uint8_t* data, uint32_t size, int16_t x, int16_t y)
+{
+	return decodePng(NULL, data, size, x, y);
+}
+
+// One band is an MCU row: max_v_samp_factor blocks of 8 scanlines
+bool RA8875ImageDecoder::decodeJpeg(FILE* file, const uint8_t* data, uint32_t size, int16_t x, int16_t y)
+{
+	struct jpeg_decompress_struct cinfo;
+	JpegError err;
+	cinfo.err = jpeg_std_error(&err.mgr);
+	err.mgr.error_exit = jpegErrorExit;
+	if (setjmp(err.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+	jpeg_create_decompress(&cinfo);
+	if (file) jpeg_stdio_src(&cinfo, file);
+	else jpeg_mem_src(&cinfo, (unsigned char*)data, size);
+	jpeg_read_header(&cinfo, TRUE);
+	cinfo.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&cinfo);
+	uint32_t stride = cinfo.output_width * 3;
+	uint32_t bandRows = cinfo.max_v_samp_factor * DCTSIZE;
+	uint8_t* band = bandBuffer(stride * bandRows);
+	// Rows below the screen are not decoded at all
+	while (cinfo.output_scanline < cinfo.output_height && y + (int32_t)cinfo.output_scanline < _tft->get_height())
+	{
+		uint32_t top = cinfo.output_scanline, rows = 0;
+		while (rows < bandRows && cinfo.output_scanline < cinfo.output_height)
+		{
+			JSAMPROW row = band + rows * stride;
+			rows += jpeg_read_scanlines(&cinfo, &row, 1);
+		}
+		sendBand(band, x, y + top, cinfo.output_width, rows);
+	}
+	if (cinfo.output_scanline == cinfo.output_height) jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	_stats.images++;
+	return true;
+}
+
+bool RA8875ImageDecoder::decodePng(FILE* file, const uint8_t* data, uint32_t size, int16_t x, int16_t y)
+{
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png == NULL) return false;
+	png_infop info = png_create_info_struct(png);
+	if (info == NULL)
+	{
+		png_destroy_read_struct(&png, NULL, NULL);
+		return false;
+	}
+	PngMemory mem = { data, size, 0 };
+	if (setjmp(png_jmpbuf(png)))
+	{
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	if (file) png_init_io(png, file);
+	else png_set_read_fn(png, &mem, pngReadMemory);
+	png_read_info(png, info);
+	if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE)
+	{
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	// Everything to 8 bit RGB: palette and low bit depths expanded, 16 bit
+	// samples cut, gray copied into all channels, alpha dropped
+	png_set_expand(png);
+	png_set_strip_16(png);
+	png_set_strip_alpha(png);
+	png_set_gray_to_rgb(png);
+	png_read_update_info(png, info);
+	uint32_t width = png_get_image_width(png, info), height = png_get_image_height(png, info);
+	uint32_t stride = width * 3;
+	uint8_t* band = bandBuffer(stride * RA8875_IMAGE_PNG_BAND);
+	for (uint32_t top = 0; top < height && y + (int32_t)top < _tft->get_height(); )
+	{
+		uint32_t rows = height - top < RA8875_IMAGE_PNG_BAND ? height - top : RA8875_IMAGE_PNG_BAND;
+		for (uint32_t i = 0; i < rows; i++) png_read_row(png, band + i * stride, NULL);
+		sendBand(band, x, y + top, width, rows);
+		top += rows;
+	}
+	png_destroy_read_struct(&png, &info, NULL);
+	_stats.images++;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ra8875.h"
+#include <stdio.h>
+
+#define RA8875_IMAGE_PNG_BAND	16      // PNG scanlines decoded per band
+
+struct RA8875ImageStats
+{
+	uint32_t images;        ///< Images decoded without error
+	uint32_t bands;         ///< Bands sent to the display
+	uint32_t rows;          ///< Decoded rows, clipped ones included
+	uint32_t bufferBytes;   ///< Largest band buffer held, the only decode memory besides the codec's own
+};
+
+// Decodes JPEG and PNG images straight onto the display. JPEG is read one MCU
+// row at a time and PNG in bands of RA8875_IMAGE_PNG_BAND scanlines; each band
+// is dithered if asked, clipped to the screen and handed to drawImageAsync as
+// RGB888, so it is converted into the SPI staging buffers without a full frame
+// copy. Once RA8875::startAsync has been called the I/O thread sends a band
+// while the next one decodes, otherwise every band is written before the next.
+// Interlaced PNGs need the whole image to finish a row and are refused, PNG
+// alpha is dropped.
+class RA8875ImageDecoder
+{
+public:
+	RA8875ImageDecoder(RA8875* tft);
+	~RA8875ImageDecoder();
+
+	// Ordered 4x4 dither before truncating to RGB565, hides banding in gradients
+	void setDither(bool dither) { _dither = dither; }
+	bool drawFile(const char* path, int16_t x, int16_t y);
+	bool drawJpeg(const char* path, int16_t x, int16_t y);
+	bool drawJpeg(const uint8_t* data, uint32_t size, int16_t x, int16_t y);
+	bool drawPng(const char* path, int16_t x, int16_t y);
+	bool drawPng(const uint8_t* data, uint32_t size, int16_t x, int16_t y);
+	const RA8875ImageStats& stats() const { return _stats; }
+	void resetStats();
+private:
+	RA8875* _tft;
+	bool _dither;
+	uint8_t* _band;
+	uint32_t _bandSize;
+	RA8875ImageStats _stats;
+
+	uint8_t* bandBuffer(uint32_t size);
+	void sendBand(uint8_t* rgb, int16_t x, int16_t y, uint16_t w, uint16_t h);
+	bool decodeJpeg(FILE* file, const uint8_t* data, uint32_t size, int16_t x, int16_t y);
+	bool decodePng(FILE* file, const uint8_t* data, uint32_t size, int16_t x, int16_t y);
+};
@@ -0,0 +1,179 @@
+#include "ra8875_pack.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t monoSize(uint32_t w, uint32_t h)
+{
+	return ((w + 7) >> 3) * h;
+}
+
+RA8875AssetPack::RA8875AssetPack(RA8875* tft)
+{
+	_tft = tft;
+	_base = NULL;
+	_size = 0;
+	_entries = NULL;
+	_count = 0;
+}
+
+RA8875AssetPack::~RA8875AssetPack()
+{
+	close();
+}
+
+bool RA8875AssetPack::open(const char* path)
+{
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(AssetPackHeader))
+	{
+		::close(fd);
+		return false;
+	}
+	void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (base == MAP_FAILED) return false;
+	// Fault the pages in now rather than in the middle of the first frame
+	madvise(base, st.st_size, MADV_WILLNEED);
+	_base = (const uint8_t*)base;
+	_size = st.st_size;
+	const AssetPackHeader* header = (const AssetPackHeader*)_base;
+	_entries = (const AssetPackEntry*)(_base + header->tableOffset);
+	_count = header->count;
+	if (!validate())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void RA8875AssetPack::close()
+{
+	if (_base) munmap((void*)_base, _size);
+	_base = NULL;
+	_size = 0;
+	_entries = NULL;
+	_count = 0;
+}
+
+// Everything a draw relies on is checked here once, so the draw paths can
+// trust offsets and sizes without bounds checks of their own
+bool RA8875AssetPack::validate() const
+{
+	const AssetPackHeader* header = (const AssetPackHeader*)_base;
+	if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION || header->fileSize != _size) return false;
+	if (header->tableOffset & 3) return false;
+	if ((uint64_t)header->tableOffset + (uint64_t)_count * sizeof(AssetPackEntry) > _size) return false;
+	for (uint16_t i = 0; i < _count; i++)
+	{
+		const AssetPackEntry& e = _entries[i];
+		if (memchr(e.name, 0, ASSET_PACK_NAME) == NULL) return false;
+		if (i > 0 && strcmp(_entries[i - 1].name, e.name) >= 0) return false;
+		if ((uint64_t)e.offset + e.size > _size) return false;
+		switch (e.type)
+		{
+		case ASSET_RGB565:
+			if (e.size != (uint32_t)e.w * e.h * 2) return false;
+			break;
+		case ASSET_MONO:
+			if (e.size != monoSize(e.w, e.h)) return false;
+			break;
+		case ASSET_FONT:
+		{
+			if ((e.offset & 3) || e.size != e.glyphs * sizeof(AssetPackGlyph) || e.dataOffset > _size) return false;
+			const AssetPackGlyph* glyphs = (const AssetPackGlyph*)(_base + e.offset);
+			for (uint16_t g = 0; g < e.glyphs; g++)
+			{
+				if (g > 0 && glyphs[g - 1].codepoint >= glyphs[g].codepoint) return false;
+				if ((uint64_t)e.dataOffset + glyphs[g].offset + monoSize(glyphs[g].w, glyphs[g].h) > _size) return false;
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+const AssetPackEntry* RA8875AssetPack::find(const char* name) const
+{
+	int32_t lo = 0, hi = (int32_t)_count - 1;
+	while (lo <= hi)
+	{
+		int32_t mid = (lo + hi) >> 1;
+		int c = strcmp(_entries[mid].name, name);
+		if (c == 0) return &_entries[mid];
+		if (c < 0) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return NULL;
+}
+
+const AssetPackGlyph* RA8875AssetPack::glyph(const AssetPackEntry* font, uint32_t codepoint) const
+{
+	const AssetPackGlyph* glyphs = (const AssetPackGlyph*)(_base + font->offset);
+	int32_t lo = 0, hi = (int32_t)font->glyphs - 1;
+	while (lo <= hi)
+	{
+		int32_t mid = (lo + hi) >> 1;
+		if (glyphs[mid].codepoint == codepoint) return &glyphs[mid];
+		if (glyphs[mid].codepoint < codepoint) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return NULL;
+}
+
+bool RA8875AssetPack::draw(const char* name, int16_t x, int16_t y, uint16_t fg, uint16_t bg, bool transparent)
+{
+	const AssetPackEntry* e = find(name);
+	return e != NULL && draw(e, x, y, fg, bg, transparent);
+}
+
+bool RA8875AssetPack::draw(const AssetPackEntry* e, int16_t x, int16_t y, uint16_t fg, uint16_t bg, bool transparent)
+{
+	switch (e->type)
+	{
+	case ASSET_RGB565:
+		_tft->drawImage(data(e), PIXEL_RGB565_BUS, x, y, e->w, e->h);
+		return true;
+	case ASSET_MONO:
+		_tft->drawBitmap1bpp(x, y, e->w, e->h, data(e), fg, bg, transparent);
+		return true;
+	}
+	return false;
+}
+
+int16_t RA8875AssetPack::drawText(const char* font, int16_t x, int16_t y, const char* text, uint16_t fg, uint16_t bg, bool transparent)
+{
+	const AssetPackEntry* f = find(font);
+	if (f == NULL || f->type != ASSET_FONT) return x;
+	const uint8_t* bitmaps = _base + f->dataOffset;
+	for (const uint8_t* c = (const uint8_t*)text; *c; c++)
+	{
+		const AssetPackGlyph* g = glyph(f, *c);
+		if (g == NULL) continue;
+		if (g->w && g->h) _tft->drawBitmap1bpp(x + g->xOffset, y + g->yOffset, g->w, g->h, bitmaps + g->offset, fg, bg, transparent);
+		x += g->advance;
+	}
+	return x;
+}
+
+int16_t RA8875AssetPack::textWidth(const char* font, const char* text) const
+{
+	const AssetPackEntry* f = find(font);
+	if (f == NULL || f->type != ASSET_FONT) return 0;
+	int16_t w = 0;
+	for (const uint8_t* c = (const uint8_t*)text; *c; c++)
+	{
+		const AssetPackGlyph* g = glyph(f, *c);
+		if (g) w += g->advance;
+	}
+	return w;
+}
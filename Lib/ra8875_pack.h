@@ -0,0 +1,39 @@
+#pragma once
+#include "ra8875.h"
+#include "AssetPack.h"
+
+// Read only mapping of an asset pack built by Tools/mkassetpack. open() checks
+// the header and that every entry and glyph lies inside the file once; after
+// that a draw is a table lookup and a bus write straight out of the mapping,
+// nothing is decoded or copied. The pack has to stay open until asynchronous
+// draws from it have completed.
+class RA8875AssetPack
+{
+public:
+	RA8875AssetPack(RA8875* tft);
+	~RA8875AssetPack();
+
+	bool open(const char* path);
+	void close();
+	bool isOpen() const { return _base != NULL; }
+	uint16_t count() const { return _count; }
+	const AssetPackEntry* entry(uint16_t index) const { return index < _count ? &_entries[index] : NULL; }
+	const AssetPackEntry* find(const char* name) const;
+	const uint8_t* data(const AssetPackEntry* e) const { return _base + e->offset; }
+	const AssetPackGlyph* glyph(const AssetPackEntry* font, uint32_t codepoint) const;
+
+	// RGB565 images ignore the colors, mono images draw set bits in fg
+	bool draw(const char* name, int16_t x, int16_t y, uint16_t fg = 0xFFFF, uint16_t bg = 0, bool transparent = true);
+	bool draw(const AssetPackEntry* e, int16_t x, int16_t y, uint16_t fg = 0xFFFF, uint16_t bg = 0, bool transparent = true);
+	// Draws one byte per codepoint and returns the pen position after the text
+	int16_t drawText(const char* font, int16_t x, int16_t y, const char* text, uint16_t fg, uint16_t bg = 0, bool transparent = true);
+	int16_t textWidth(const char* font, const char* text) const;
+private:
+	RA8875* _tft;
+	const uint8_t* _base;
+	uint32_t _size;
+	const AssetPackEntry* _entries;
+	uint16_t _count;
+
+	bool validate() const;
+};
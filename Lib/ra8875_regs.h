@@ -1,5 +1,15 @@
 ﻿#pragma once
 
+// Command/Data pins for SPI: the first byte of every chip select frame
+#define RA8875_DATAWRITE        0x00
+#define RA8875_DATAREAD         0x40
+#define RA8875_CMDWRITE         0x80
+#define RA8875_CMDREAD          0xC0
+
+// Status register, read with RA8875_CMDREAD
+#define RA8875_STSR_MEMBUSY     0x80    // Memory read/write busy, also while a glyph renders
+#define RA8875_STSR_BTEBUSY     0x40
+
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // System & Configuration Registers
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -341,8 +351,34 @@ from 0 to 255
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // Block Transfer Engine(BTE) Control Registers
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/* BTE Function Control Register 0 [0x50]
+----- Bit 7 (BTE Function Enable / Status)
+write 1: start, read 1: BTE busy
+----- Bit 6 (BTE Source Data Select)
+0: block mode, 1: linear mode
+----- Bit 5 (BTE Destination Data Select)
+0: block mode, 1: linear mode */
 #define RA8875_BECR0 0x50//BTE Function Control Register 0
+#define RA8875_BECR0_ENABLE          0x80
+#define RA8875_BECR0_SRC_LINEAR      0x40
+#define RA8875_BECR0_DST_LINEAR      0x20
+/* BTE Function Control Register 1 [0x51]
+----- Bit 7,6,5,4 (BTE ROP Code, see RA8875RopEnum)
+----- Bit 3,2,1,0 (BTE Operation Code) */
 #define RA8875_BECR1 0x51//BTE Function Control Register 1
+#define RA8875_BECR1_WRITE_ROP                  0x00
+#define RA8875_BECR1_READ                       0x01
+#define RA8875_BECR1_MOVE_POSITIVE              0x02
+#define RA8875_BECR1_MOVE_NEGATIVE              0x03
+#define RA8875_BECR1_WRITE_TRANSPARENT          0x04
+#define RA8875_BECR1_MOVE_TRANSPARENT           0x05
+#define RA8875_BECR1_PATTERN_ROP                0x06
+#define RA8875_BECR1_PATTERN_TRANSPARENT        0x07
+#define RA8875_BECR1_COLOR_EXPAND               0x08
+#define RA8875_BECR1_COLOR_EXPAND_TRANSPARENT   0x09
+#define RA8875_BECR1_MOVE_COLOR_EXPAND          0x0A
+#define RA8875_BECR1_MOVE_COLOR_EXPAND_TRANSPARENT 0x0B
+#define RA8875_BECR1_SOLID_FILL                 0x0C
 /* Layer Transparency Register 0 [0x52]
 ----- Bit 7,6 (Layer1/2 Scroll Mode)
 00: Layer 1/2 scroll simultaneously
@@ -396,6 +432,7 @@ from 0 to 255
 #define RA8875_BEWR1	0x5D//BTE Width Register 1
 #define RA8875_BEHR0	0x5E//BTE Height Register 0
 #define RA8875_BEHR1	0x5F//BTE Height Register 1
+#define RA8875_BTE_LAYER2	0x80//Layer select bit in VSBE1 and VDBE1
 /* Pattern Set No for BTE [0x65]
 ----- Bit 7 (Pattern Format)
 0: 8x8
@@ -0,0 +1,804 @@
+#include "ra8875_sim.h"
+#include "ra8875_regs.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define SIM_DEFAULT_CORE_CLOCK	250000000   // SPI core clock of the Pi the driver targets
+#define SIM_DEFAULT_FILL_RATE	30000000    // Engine pixels per second
+
+// Stand-in for the CGROM: 8x8 ASCII glyphs, bit 0 is the leftmost pixel. Every row
+// is shown twice to fill the 8x16 character cell, so text metrics match the chip.
+static const uint8_t simFont[96][8] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\'
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // DEL
+};
+
+RA8875Sim::RA8875Sim()
+{
+	for (int i = 0; i < RA8875_SIM_LAYERS; i++)
+	{
+		_vram[i] = new uint16_t[RA8875_SIM_MAX_WIDTH * RA8875_SIM_MAX_HEIGHT];
+	}
+	_coreClock = SIM_DEFAULT_CORE_CLOCK;
+	_fixedSclk = 0;
+	_clockDivider = 1024;
+	_frameOverheadNs = 0;
+	_fillRate = SIM_DEFAULT_FILL_RATE;
+	reset();
+}
+
+RA8875Sim::~RA8875Sim()
+{
+	for (int i = 0; i < RA8875_SIM_LAYERS; i++)
+	{
+		delete[] _vram[i];
+	}
+}
+
+// Power on state: registers, display RAM, CGRAM, clock and counters
+void RA8875Sim::reset()
+{
+	for (int i = 0; i < RA8875_SIM_LAYERS; i++)
+	{
+		memset(_vram[i], 0, RA8875_SIM_MAX_WIDTH * RA8875_SIM_MAX_HEIGHT * sizeof(uint16_t));
+	}
+	memset(_cgram, 0, sizeof(_cgram));
+	resetRegisters();
+	_selected = false;
+	_prefixPending = false;
+	_prefix = 0;
+	_now = 0;
+	_psRemainder = 0;
+	_busyUntil = 0;
+	_enginePixels = 0;
+	_engineIrq = 0;
+	setClock(_clockDivider);
+	resetStats();
+}
+
+// Soft reset through PWRR leaves display RAM alone
+void RA8875Sim::resetRegisters()
+{
+	memset(_regs, 0, sizeof(_regs));
+	_regs[0] = 0x75; // product ID, checked by PLLinit
+	_regs[RA8875_HDWR] = RA8875_SIM_MAX_WIDTH / 8 - 1;
+	setReg16(RA8875_VDHR0, RA8875_SIM_MAX_HEIGHT - 1);
+	setReg16(RA8875_HEAW0, RA8875_SIM_MAX_WIDTH - 1);
+	setReg16(RA8875_VEAW0, RA8875_SIM_MAX_HEIGHT - 1);
+	_cmd = 0;
+	_cgramIndex = 0;
+	_highPending = false;
+	_highByte = 0;
+	_readDummy = true;
+	_readLow = false;
+	_readPixel = 0;
+	_bteWriting = false;
+}
+
+void RA8875Sim::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t RA8875Sim::sclk() const
+{
+	if (_fixedSclk) return _fixedSclk;
+	return _coreClock / (_clockDivider == 0 ? 65536 : _clockDivider);
+}
+
+uint16_t RA8875Sim::width() const
+{
+	uint32_t w = (_regs[RA8875_HDWR] + 1) * 8;
+	return w > RA8875_SIM_MAX_WIDTH ? RA8875_SIM_MAX_WIDTH : w;
+}
+
+uint16_t RA8875Sim::height() const
+{
+	uint32_t h = reg16(RA8875_VDHR0) + 1;
+	return h > RA8875_SIM_MAX_HEIGHT ? RA8875_SIM_MAX_HEIGHT : h;
+}
+
+uint16_t RA8875Sim::pixel(uint8_t layer, uint16_t x, uint16_t y) const
+{
+	if (x >= RA8875_SIM_MAX_WIDTH || y >= RA8875_SIM_MAX_HEIGHT) return 0;
+	return _vram[layer & 1][y * RA8875_SIM_MAX_WIDTH + x];
+}
+
+// Writes the visible area of a layer as a binary PPM, for eyeballing and diffing
+bool RA8875Sim::savePPM(const char* path, uint8_t layer) const
+{
+	FILE* f = fopen(path, "wb");
+	if (f == NULL) return false;
+	fprintf(f, "P6\n%u %u\n255\n", width(), height());
+	for (uint16_t y = 0; y < height(); y++)
+	{
+		for (uint16_t x = 0; x < width(); x++)
+		{
+			uint16_t c = pixel(layer, x, y);
+			uint8_t rgb[3] = { (uint8_t)((c >> 8) & 0xF8), (uint8_t)((c >> 3) & 0xFC), (uint8_t)(c << 3) };
+			fwrite(rgb, 1, 3, f);
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+///////////////// Bus
+
+void RA8875Sim::select()
+{
+	_selected = true;
+	_prefixPending = true;
+	_stats.frames++;
+	advance((uint64_t)_frameOverheadNs * 1000);
+}
+
+void RA8875Sim::deselect()
+{
+	_selected = false;
+}
+
+void RA8875Sim::setClock(uint16_t clockDivider)
+{
+	_clockDivider = clockDivider;
+	_bytePs = (uint32_t)(8000000000000ULL / sclk());
+}
+
+void RA8875Sim::advance(uint64_t ps)
+{
+	ps += _psRemainder;
+	_now += ps / 1000;
+	_stats.wireNs += ps / 1000;
+	_psRemainder = ps % 1000;
+}
+
+// The first byte of a frame selects command/data and direction, every following
+// byte is a command, a data write or a read of the current register
+void RA8875Sim::transfer(const uint8_t* tx, uint8_t* rx, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+	{
+		uint8_t out = tx ? tx[i] : 0;
+		uint8_t in = 0;
+		advance(_bytePs);
+		_stats.bytes++;
+		if (_prefixPending)
+		{
+			_prefix = out;
+			_prefixPending = false;
+		}
+		else
+		{
+			switch (_prefix & 0xC0)
+			{
+			case RA8875_CMDWRITE:
+				onCommand(out);
+				break;
+			case RA8875_DATAWRITE:
+				onWrite(out);
+				break;
+			case RA8875_DATAREAD:
+				in = onRead();
+				break;
+			case RA8875_CMDREAD:
+				in = onStatusRead();
+				break;
+			}
+		}
+		if (rx) rx[i] = in;
+	}
+}
+
+void RA8875Sim::onCommand(uint8_t cmd)
+{
+	_cmd = cmd;
+	if (cmd == RA8875_MRWC)
+	{
+		_highPending = false;
+		_readDummy = true;
+		_readLow = false;
+		_cgramIndex = _regs[RA8875_CGSR] * 16;
+	}
+}
+
+void RA8875Sim::onWrite(uint8_t data)
+{
+	if (_cmd == RA8875_MRWC)
+	{
+		onMemoryWrite(data);
+		return;
+	}
+	_stats.regWrites++;
+	switch (_cmd)
+	{
+	case RA8875_PWRR:
+		if (data & RA8875_PWRR_SOFTRESET) resetRegisters();
+		_regs[RA8875_PWRR] = data & ~RA8875_PWRR_SOFTRESET;
+		break;
+	case RA8875_MCLR:
+		_regs[RA8875_MCLR] = data;
+		if (data & RA8875_MCLR_START) clearMemory(data);
+		break;
+	case RA8875_DCR:
+		_regs[RA8875_DCR] = data;
+		if (data & (RA8875_DCR_LINESQUTRI_START | RA8875_DCR_CIRCLE_START)) drawDCR(data);
+		break;
+	case RA8875_ELLIPSE:
+		_regs[RA8875_ELLIPSE] = data;
+		if (data & RA8875_ELLIPSE_STATUS) drawEllipse(data);
+		break;
+	case RA8875_BECR0:
+		_regs[RA8875_BECR0] = data;
+		if (data & RA8875_BECR0_ENABLE) runBTE();
+		break;
+	case RA8875_INTC2:
+		// Interrupt flags are cleared by writing 1
+		latchInterrupts();
+		_regs[RA8875_INTC2] &= ~data;
+		break;
+	default:
+		_regs[_cmd] = data;
+		break;
+	}
+}
+
+// Start bits of the engine registers read back as busy flags until the
+// simulated engine time has passed
+uint8_t RA8875Sim::onRead()
+{
+	_stats.regReads++;
+	if (_cmd == RA8875_MRWC)
+	{
+		if (_readDummy)
+		{
+			_readDummy = false;
+			return 0;
+		}
+		if (_readLow)
+		{
+			_readLow = false;
+			return _readPixel & 0xFF;
+		}
+		uint16_t x = reg16(RA8875_RCURH0), y = reg16(RA8875_RCURV0);
+		_readPixel = pixel(writeLayer(), x, y);
+		_readLow = true;
+		if (++x > reg16(RA8875_HEAW0))
+		{
+			x = reg16(RA8875_HSAW0);
+			if (++y > reg16(RA8875_VEAW0)) y = reg16(RA8875_VSAW0);
+		}
+		setReg16(RA8875_RCURH0, x);
+		setReg16(RA8875_RCURV0, y);
+		return _readPixel >> 8;
+	}
+	uint8_t mask = 0;
+	if (_cmd == RA8875_DCR) mask = RA8875_DCR_LINESQUTRI_STATUS | RA8875_DCR_CIRCLE_STATUS;
+	else if (_cmd == RA8875_ELLIPSE) mask = RA8875_ELLIPSE_STATUS;
+	else if (_cmd == RA8875_MCLR) mask = RA8875_MCLR_READSTATUS;
+	else if (_cmd == RA8875_BECR0) mask = RA8875_BECR0_ENABLE;
+	else if (_cmd == RA8875_INTC2) latchInterrupts();
+	if (mask && (_regs[_cmd] & mask))
+	{
+		if (busy()) _stats.busyReads++;
+		else _regs[_cmd] &= ~mask;
+	}
+	return _regs[_cmd];
+}
+
+// STSR: bit 7 memory read/write busy, bit 6 BTE busy
+uint8_t RA8875Sim::onStatusRead()
+{
+	_stats.regReads++;
+	if (!busy()) return 0;
+	_stats.busyReads++;
+	return 0x80 | (_engineIrq & RA8875_INTC2_BTE ? 0x40 : 0);
+}
+
+void RA8875Sim::setReg16(uint8_t reg, uint16_t value)
+{
+	_regs[reg] = value & 0xFF;
+	_regs[reg + 1] = value >> 8;
+}
+
+uint8_t RA8875Sim::writeLayer() const
+{
+	return _regs[RA8875_MWCR1] & 0x01;
+}
+
+// 16bpp colors are kept as 5/6/5 bits in the three color registers
+uint16_t RA8875Sim::color(uint8_t reg) const
+{
+	return ((_regs[reg] & 0x1F) << 11) | ((_regs[reg + 1] & 0x3F) << 5) | (_regs[reg + 2] & 0x1F);
+}
+
+void RA8875Sim::startEngine()
+{
+	latchInterrupts();
+	uint64_t ns = (uint64_t)_enginePixels * 1000000000ULL / _fillRate;
+	_busyUntil = _now + ns;
+	_stats.engineNs += ns;
+	_stats.enginePixels += _enginePixels;
+	_enginePixels = 0;
+}
+
+// Raises the INTC2 flag of an operation once its simulated time has passed
+void RA8875Sim::latchInterrupts()
+{
+	if (_engineIrq == 0 || busy()) return;
+	_regs[RA8875_INTC2] |= _engineIrq;
+	_engineIrq = 0;
+}
+
+///////////////// Display RAM
+
+// MWCR1 bits 3-2 pick the destination: display RAM, CGRAM, or the cursor and
+// pattern RAMs which are not modelled. Pixels arrive high byte first.
+void RA8875Sim::onMemoryWrite(uint8_t data)
+{
+	uint8_t destination = (_regs[RA8875_MWCR1] >> 2) & 0x03;
+	if (destination == 0x01)
+	{
+		_cgram[_cgramIndex++ % RA8875_SIM_CGRAM_SIZE] = data;
+		return;
+	}
+	if (destination != 0x00) return;
+	if (_bteWriting)
+	{
+		expandBits(data);
+		return;
+	}
+	if (_regs[RA8875_MWCR0] & RA8875_MWCR0_TXTMODE)
+	{
+		writeChar(data);
+		return;
+	}
+	if (!_highPending)
+	{
+		_highByte = data;
+		_highPending = true;
+		return;
+	}
+	_highPending = false;
+	writePixel((_highByte << 8) | data);
+}
+
+// Stores at the write cursor and advances it through the active window
+void RA8875Sim::writePixel(uint16_t c)
+{
+	uint16_t x = reg16(RA8875_CURH0), y = reg16(RA8875_CURV0);
+	if (x < RA8875_SIM_MAX_WIDTH && y < RA8875_SIM_MAX_HEIGHT)
+	{
+		_vram[writeLayer()][y * RA8875_SIM_MAX_WIDTH + x] = c;
+	}
+	_stats.pixelWrites++;
+	if (++x > reg16(RA8875_HEAW0))
+	{
+		x = reg16(RA8875_HSAW0);
+		if (++y > reg16(RA8875_VEAW0)) y = reg16(RA8875_VSAW0);
+	}
+	setReg16(RA8875_CURH0, x);
+	setReg16(RA8875_CURV0, y);
+}
+
+// Renders one 8x16 cell at the font cursor, enlarged by FNCR1, and moves the
+// cursor on, wrapping at the right edge of the active window
+void RA8875Sim::writeChar(uint8_t ch)
+{
+	uint8_t fncr1 = _regs[RA8875_FNCR1];
+	int32_t sx = ((fncr1 >> 2) & 0x03) + 1;
+	int32_t sy = (fncr1 & 0x03) + 1;
+	bool transparent = (fncr1 & 0x40) != 0;
+	bool cgram = (_regs[RA8875_FNCR0] & 0x80) != 0;
+	uint16_t fg = color(RA8875_FGCR0), bg = color(RA8875_BGCR0);
+	int32_t x0 = reg16(RA8875_F_CURXL), y0 = reg16(RA8875_F_CURYL);
+	for (int32_t row = 0; row < 16; row++)
+	{
+		uint8_t bits;
+		if (cgram) bits = _cgram[ch * 16 + row];
+		else bits = ch >= 0x20 && ch < 0x80 ? simFont[ch - 0x20][row >> 1] : 0;
+		for (int32_t col = 0; col < 8; col++)
+		{
+			bool on = cgram ? (bits & (0x80 >> col)) != 0 : (bits & (1 << col)) != 0;
+			if (!on && transparent) continue;
+			for (int32_t dy = 0; dy < sy; dy++)
+			{
+				span(x0 + col * sx, x0 + col * sx + sx - 1, y0 + row * sy + dy, on ? fg : bg);
+			}
+		}
+	}
+	_stats.chars++;
+	x0 += 8 * sx;
+	if (x0 + 8 * sx - 1 > reg16(RA8875_HEAW0))
+	{
+		x0 = reg16(RA8875_HSAW0);
+		y0 += 16 * sy + (_regs[RA8875_FLDR] & 0x1F);
+	}
+	setReg16(RA8875_F_CURXL, x0);
+	setReg16(RA8875_F_CURYL, y0);
+	startEngine();
+}
+
+void RA8875Sim::clearMemory(uint8_t mclr)
+{
+	uint16_t bg = color(RA8875_BGCR0);
+	int32_t left = 0, top = 0, right = width() - 1, bottom = height() - 1;
+	if (mclr & RA8875_MCLR_ACTIVE)
+	{
+		left = reg16(RA8875_HSAW0);
+		top = reg16(RA8875_VSAW0);
+		right = reg16(RA8875_HEAW0);
+		bottom = reg16(RA8875_VEAW0);
+	}
+	uint16_t* vram = _vram[writeLayer()];
+	for (int32_t y = top; y <= bottom && y < RA8875_SIM_MAX_HEIGHT; y++)
+	{
+		for (int32_t x = left; x <= right && x < RA8875_SIM_MAX_WIDTH; x++)
+		{
+			vram[y * RA8875_SIM_MAX_WIDTH + x] = bg;
+			_enginePixels++;
+		}
+	}
+	startEngine();
+}
+
+///////////////// Geometry engine
+
+// Engine output is clipped to the active window
+void RA8875Sim::plot(int32_t x, int32_t y, uint16_t c)
+{
+	if (x < reg16(RA8875_HSAW0) || x > reg16(RA8875_HEAW0) || y < reg16(RA8875_VSAW0) || y > reg16(RA8875_VEAW0)) return;
+	if (x >= RA8875_SIM_MAX_WIDTH || y >= RA8875_SIM_MAX_HEIGHT) return;
+	_vram[writeLayer()][y * RA8875_SIM_MAX_WIDTH + x] = c;
+	_enginePixels++;
+}
+
+void RA8875Sim::span(int32_t x0, int32_t x1, int32_t y, uint16_t c)
+{
+	if (x0 > x1)
+	{
+		int32_t t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	for (int32_t x = x0; x <= x1; x++) plot(x, y, c);
+}
+
+void RA8875Sim::line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t c)
+{
+	int32_t dx = x1 > x0 ? x1 - x0 : x0 - x1, sx = x0 < x1 ? 1 : -1;
+	int32_t dy = y1 > y0 ? y0 - y1 : y1 - y0, sy = y0 < y1 ? 1 : -1;
+	int32_t err = dx + dy;
+	while (1)
+	{
+		plot(x0, y0, c);
+		if (x0 == x1 && y0 == y1) break;
+		int32_t e2 = 2 * err;
+		if (e2 >= dy)
+		{
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx)
+		{
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+void RA8875Sim::triangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t c, bool filled)
+{
+	if (filled)
+	{
+		int32_t xs[3] = { x0, x1, x2 }, ys[3] = { y0, y1, y2 };
+		int32_t top = y0, bottom = y0;
+		for (int i = 1; i < 3; i++)
+		{
+			if (ys[i] < top) top = ys[i];
+			if (ys[i] > bottom) bottom = ys[i];
+		}
+		for (int32_t y = top; y <= bottom; y++)
+		{
+			int32_t left = 0x7FFFFFFF, right = -0x7FFFFFFF;
+			for (int i = 0; i < 3; i++)
+			{
+				int j = (i + 1) % 3;
+				int32_t ya = ys[i], yb = ys[j];
+				if (y < (ya < yb ? ya : yb) || y > (ya > yb ? ya : yb)) continue;
+				int32_t x = ya == yb ? xs[i] : xs[i] + (y - ya) * (xs[j] - xs[i]) / (yb - ya);
+				if (ya == yb && xs[j] < left) left = xs[j];
+				if (ya == yb && xs[j] > right) right = xs[j];
+				if (x < left) left = x;
+				if (x > right) right = x;
+			}
+			if (left <= right) span(left, right, y, c);
+		}
+	}
+	line(x0, y0, x1, y1, c);
+	line(x1, y1, x2, y2, c);
+	line(x2, y2, x0, y0, c);
+}
+
+// part < 0 draws the whole ellipse, 0..3 one quadrant of it, counting from the
+// lower left one clockwise as ELLIPSE bits 1-0 do
+void RA8875Sim::ellipse(int32_t xc, int32_t yc, int32_t a, int32_t b, int8_t part, uint16_t c, bool filled)
+{
+	bool left = part == 0 || part == 1;
+	bool top = part == 1 || part == 2;
+	int32_t xFrom = part < 0 || left ? -a : 0, xTo = part < 0 || !left ? a : 0;
+	int32_t yFrom = part < 0 || top ? -b : 0, yTo = part < 0 || !top ? b : 0;
+	for (int32_t dy = yFrom; dy <= yTo; dy++)
+	{
+		int32_t hw = b == 0 ? a : (int32_t)floor(a * sqrt(1.0 - (double)dy * dy / ((double)b * b)) + 0.5);
+		int32_t x0 = xFrom < -hw ? -hw : xFrom, x1 = xTo > hw ? hw : xTo;
+		if (filled)
+		{
+			span(xc + x0, xc + x1, yc + dy, c);
+		}
+		else
+		{
+			if (x0 == -hw) plot(xc - hw, yc + dy, c);
+			if (x1 == hw) plot(xc + hw, yc + dy, c);
+		}
+	}
+	if (filled) return;
+	// Second pass along x closes the gaps where the outline runs flat
+	for (int32_t dx = xFrom; dx <= xTo; dx++)
+	{
+		int32_t hh = a == 0 ? b : (int32_t)floor(b * sqrt(1.0 - (double)dx * dx / ((double)a * a)) + 0.5);
+		if (yFrom <= -hh) plot(xc + dx, yc - hh, c);
+		if (yTo >= hh) plot(xc + dx, yc + hh, c);
+	}
+}
+
+void RA8875Sim::drawDCR(uint8_t dcr)
+{
+	uint16_t fg = color(RA8875_FGCR0);
+	bool filled = (dcr & RA8875_DCR_FILL) != 0;
+	if (dcr & RA8875_DCR_CIRCLE_START)
+	{
+		int32_t r = _regs[RA8875_DCRR];
+		ellipse(reg16(RA8875_DCHR0), reg16(RA8875_DCVR0), r, r, -1, fg, filled);
+	}
+	else
+	{
+		int32_t x0 = reg16(RA8875_DLHSR0), y0 = reg16(RA8875_DLVSR0);
+		int32_t x1 = reg16(RA8875_DLHER0), y1 = reg16(RA8875_DLVER0);
+		if (dcr & RA8875_DCR_DRAWTRIANGLE)
+		{
+			triangle(x0, y0, x1, y1, reg16(RA8875_DTPH0), reg16(RA8875_DTPV0), fg, filled);
+		}
+		else if ((dcr & RA8875_DCR_DRAWSQUARE) && filled)
+		{
+			for (int32_t y = y0 < y1 ? y0 : y1; y <= (y0 < y1 ? y1 : y0); y++) span(x0, x1, y, fg);
+		}
+		else if (dcr & RA8875_DCR_DRAWSQUARE)
+		{
+			line(x0, y0, x1, y0, fg);
+			line(x1, y0, x1, y1, fg);
+			line(x1, y1, x0, y1, fg);
+			line(x0, y1, x0, y0, fg);
+		}
+		else
+		{
+			line(x0, y0, x1, y1, fg);
+		}
+	}
+	startEngine();
+}
+
+// Bit 6 fills, bit 4 selects a curve, bit 5 (circle square) is not modelled
+void RA8875Sim::drawEllipse(uint8_t ctrl)
+{
+	if (!(ctrl & 0x20))
+	{
+		int8_t part = (ctrl & 0x10) ? (ctrl & 0x03) : -1;
+		ellipse(reg16(RA8875_DEHR0), reg16(RA8875_DEVR0), reg16(RA8875_ELL_A0), reg16(RA8875_ELL_B0),
+			part, color(RA8875_FGCR0), (ctrl & 0x40) != 0);
+	}
+	startEngine();
+}
+
+///////////////// Block transfer engine
+
+static uint16_t rasterOp(uint8_t rop, uint16_t s, uint16_t d)
+{
+	switch (rop & 0x0F)
+	{
+	case 0x0: return 0;
+	case 0x1: return ~(s | d);
+	case 0x2: return ~s & d;
+	case 0x3: return ~s;
+	case 0x4: return s & ~d;
+	case 0x5: return ~d;
+	case 0x6: return s ^ d;
+	case 0x7: return ~(s & d);
+	case 0x8: return s & d;
+	case 0x9: return ~(s ^ d);
+	case 0xA: return d;
+	case 0xB: return ~s | d;
+	case 0xC: return s;
+	case 0xD: return s | ~d;
+	case 0xE: return s | d;
+	}
+	return 0xFFFF;
+}
+
+// Block mode moves in both directions, transparent move (key = foreground
+// color) and solid fill. A negative move starts at the bottom right corner
+// given in the source and destination points and walks backwards. Color
+// expansion waits for its data through MRWC.
+void RA8875Sim::runBTE()
+{
+	uint8_t op = _regs[RA8875_BECR1] & 0x0F, rop = _regs[RA8875_BECR1] >> 4;
+	if (op == RA8875_BECR1_COLOR_EXPAND || op == RA8875_BECR1_COLOR_EXPAND_TRANSPARENT)
+	{
+		_bteWriting = true;
+		_bteCol = 0;
+		_bteRow = 0;
+		return;
+	}
+	int32_t sx = reg16(RA8875_HSBE0) & 0x3FF, sy = reg16(RA8875_VSBE0) & 0x1FF;
+	int32_t dx = reg16(RA8875_HDBE0) & 0x3FF, dy = reg16(RA8875_VDBE0) & 0x1FF;
+	int32_t w = reg16(RA8875_BEWR0) & 0x3FF, h = reg16(RA8875_BEHR0) & 0x3FF;
+	uint8_t srcLayer = (_regs[RA8875_VSBE1] & RA8875_BTE_LAYER2) ? 1 : 0;
+	uint16_t* dst = _vram[(_regs[RA8875_VDBE1] & RA8875_BTE_LAYER2) ? 1 : 0];
+	uint16_t fg = color(RA8875_FGCR0);
+	int32_t step = op == RA8875_BECR1_MOVE_NEGATIVE ? -1 : 1;
+	for (int32_t j = 0; j < h; j++)
+	{
+		for (int32_t i = 0; i < w; i++)
+		{
+			int32_t x = dx + i * step, y = dy + j * step;
+			if (x < 0 || y < 0 || x >= RA8875_SIM_MAX_WIDTH || y >= RA8875_SIM_MAX_HEIGHT) continue;
+			uint16_t* d = &dst[y * RA8875_SIM_MAX_WIDTH + x];
+			uint16_t s = pixel(srcLayer, sx + i * step, sy + j * step);
+			switch (op)
+			{
+			case RA8875_BECR1_MOVE_POSITIVE:
+			case RA8875_BECR1_MOVE_NEGATIVE:
+				*d = rasterOp(rop, s, *d);
+				break;
+			case RA8875_BECR1_MOVE_TRANSPARENT:
+				if (s != fg) *d = s;
+				break;
+			case RA8875_BECR1_SOLID_FILL:
+				*d = fg;
+				break;
+			default:
+				continue;
+			}
+			_enginePixels++;
+		}
+	}
+	startEngine();
+	_engineIrq |= RA8875_INTC2_BTE;
+}
+
+// One byte of color expansion data, consumed from the start bit in ROP bits 2-0
+// down. Every row starts with a new byte, leftover bits of its last byte are
+// dropped.
+void RA8875Sim::expandBits(uint8_t data)
+{
+	bool transparent = (_regs[RA8875_BECR1] & 0x0F) == RA8875_BECR1_COLOR_EXPAND_TRANSPARENT;
+	int32_t dx = reg16(RA8875_HDBE0) & 0x3FF, dy = reg16(RA8875_VDBE0) & 0x1FF;
+	int32_t w = reg16(RA8875_BEWR0) & 0x3FF, h = reg16(RA8875_BEHR0) & 0x3FF;
+	uint16_t* dst = _vram[(_regs[RA8875_VDBE1] & RA8875_BTE_LAYER2) ? 1 : 0];
+	uint16_t fg = color(RA8875_FGCR0), bg = color(RA8875_BGCR0);
+	for (int32_t bit = (_regs[RA8875_BECR1] >> 4) & 0x07; bit >= 0 && _bteRow < h; bit--)
+	{
+		bool on = (data & (1 << bit)) != 0;
+		int32_t x = dx + _bteCol, y = dy + _bteRow;
+		if ((on || !transparent) && x < RA8875_SIM_MAX_WIDTH && y < RA8875_SIM_MAX_HEIGHT)
+		{
+			dst[y * RA8875_SIM_MAX_WIDTH + x] = on ? fg : bg;
+		}
+		_enginePixels++;
+		if (++_bteCol == w)
+		{
+			_bteCol = 0;
+			_bteRow++;
+			break;
+		}
+	}
+	if (_bteRow < h) return;
+	_bteWriting = false;
+	startEngine();
+	_engineIrq |= RA8875_INTC2_BTE;
+}
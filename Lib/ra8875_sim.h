@@ -0,0 +1,120 @@
+#pragma once
+#include "SPISink.h"
+
+#define RA8875_SIM_MAX_WIDTH	800
+#define RA8875_SIM_MAX_HEIGHT	480
+#define RA8875_SIM_LAYERS		2
+#define RA8875_SIM_CGRAM_SIZE	(256 * 16)
+
+// Bus and engine counters of the emulator
+struct RA8875SimStats
+{
+	uint64_t bytes;         ///< Bytes clocked on the bus, prefixes included
+	uint32_t frames;        ///< Chip select frames
+	uint32_t regWrites;     ///< Data bytes written to registers other than MRWC
+	uint32_t regReads;      ///< Register and status reads
+	uint32_t pixelWrites;   ///< Pixels stored through MRWC
+	uint32_t enginePixels;  ///< Pixels plotted by the geometry engine and memory clear
+	uint32_t chars;         ///< Characters rendered in text mode
+	uint32_t busyReads;     ///< Status reads that found the engine busy
+	uint64_t wireNs;        ///< Estimated time on the wire, including per frame overhead
+	uint64_t engineNs;      ///< Estimated time the geometry engine was busy
+};
+
+// Behavioral model of the RA8875 as seen from its SPI port: register file, two
+// 16bpp layers of display RAM, the MRWC read/write cursors, active window, the
+// DCR/ELLIPSE geometry engine, BTE moves, color expansion and solid fill,
+// memory clear, text mode with an 8x16 CGROM font
+// and CGRAM, and the busy bits polled by RA8875::waitPoll.
+// Time is simulated: every byte costs 8 SCLK periods and every engine operation
+// keeps its busy bit set for pixels / fill rate, so polling loops run the same
+// number of times as on the bus the model is clocked at.
+// Only 16bpp, left to right / top to bottom memory writes are modelled.
+class RA8875Sim : public SPISink
+{
+public:
+	RA8875Sim();
+	~RA8875Sim();
+	void reset();
+
+	void select();
+	void deselect();
+	void transfer(const uint8_t* tx, uint8_t* rx, uint32_t size);
+	void setClock(uint16_t clockDivider);
+
+	// SCLK = core clock / divider programmed by the driver, unless pinned by setSclk
+	void setCoreClock(uint32_t hz) { _coreClock = hz; }
+	void setSclk(uint32_t hz) { _fixedSclk = hz; }
+	uint32_t sclk() const;
+	void setFrameOverhead(uint32_t ns) { _frameOverheadNs = ns; }
+	void setFillRate(uint32_t pixelsPerSecond) { _fillRate = pixelsPerSecond; }
+	uint64_t now() const { return _now; }
+
+	uint16_t width() const;
+	uint16_t height() const;
+	uint8_t reg(uint8_t reg) const { return _regs[reg]; }
+	uint16_t pixel(uint8_t layer, uint16_t x, uint16_t y) const;
+	const uint16_t* layer(uint8_t layer) const { return _vram[layer & 1]; }
+	const RA8875SimStats& stats() const { return _stats; }
+	void resetStats();
+	bool savePPM(const char* path, uint8_t layer) const;
+private:
+	uint8_t _regs[256];
+	uint16_t* _vram[RA8875_SIM_LAYERS];
+	uint8_t _cgram[RA8875_SIM_CGRAM_SIZE];
+	uint32_t _cgramIndex;
+	RA8875SimStats _stats;
+
+	bool _selected;
+	bool _prefixPending;
+	uint8_t _prefix;
+	uint8_t _cmd;
+	bool _highPending;
+	uint8_t _highByte;
+	bool _readDummy;
+	bool _readLow;
+	uint16_t _readPixel;
+
+	uint32_t _coreClock;
+	uint32_t _fixedSclk;
+	uint16_t _clockDivider;
+	uint32_t _frameOverheadNs;
+	uint32_t _fillRate;
+	uint64_t _now;
+	uint32_t _bytePs;
+	uint32_t _psRemainder;
+	uint64_t _busyUntil;
+	uint32_t _enginePixels;
+	uint8_t _engineIrq;
+	bool _bteWriting;
+	int32_t _bteCol;
+	int32_t _bteRow;
+
+	void resetRegisters();
+	void advance(uint64_t ps);
+	uint8_t onRead();
+	uint8_t onStatusRead();
+	void onCommand(uint8_t cmd);
+	void onWrite(uint8_t data);
+	void onMemoryWrite(uint8_t data);
+	uint16_t reg16(uint8_t reg) const { return _regs[reg] | (_regs[reg + 1] << 8); }
+	void setReg16(uint8_t reg, uint16_t value);
+	bool busy() const { return _now < _busyUntil || _bteWriting; }
+	void startEngine();
+	void latchInterrupts();
+	uint16_t color(uint8_t reg) const;
+	uint8_t writeLayer() const;
+
+	void plot(int32_t x, int32_t y, uint16_t c);
+	void span(int32_t x0, int32_t x1, int32_t y, uint16_t c);
+	void line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t c);
+	void triangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t c, bool filled);
+	void ellipse(int32_t xc, int32_t yc, int32_t a, int32_t b, int8_t part, uint16_t c, bool filled);
+	void drawDCR(uint8_t dcr);
+	void drawEllipse(uint8_t ctrl);
+	void clearMemory(uint8_t mclr);
+	void runBTE();
+	void expandBits(uint8_t data);
+	void writePixel(uint16_t c);
+	void writeChar(uint8_t ch);
+};
@@ -0,0 +1,274 @@
+// Builds an asset pack for RA8875AssetPack from a manifest, one asset per line:
+//
+//   image <name> <file.png>    RGB565, alpha dropped
+//   mono  <name> <file.png>    1 bpp, set where the pixel is opaque and brighter than mid gray
+//   font  <name> <file.bdf>    BDF bitmap font
+//
+// Blank lines and lines starting with # are skipped, file names are relative
+// to the working directory. Runs on the build host:
+//
+//   make tools
+//   build/tools/mkassetpack assets.txt assets.pak
+
+#include "AssetPack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct Asset
+{
+	AssetPackEntry entry;
+	std::vector<AssetPackGlyph> glyphs;
+	std::vector<uint8_t> data;      ///< Pixels, font: glyph bitmaps
+};
+
+static bool loadPng(const char* path, std::vector<uint8_t>& rgba, uint32_t& w, uint32_t& h)
+{
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&image, path)) return false;
+	image.format = PNG_FORMAT_RGBA;
+	rgba.resize(PNG_IMAGE_SIZE(image));
+	if (!png_image_finish_read(&image, NULL, &rgba[0], 0, NULL))
+	{
+		png_image_free(&image);
+		return false;
+	}
+	w = image.width;
+	h = image.height;
+	return true;
+}
+
+static bool addImage(Asset& a, const char* path, bool mono)
+{
+	std::vector<uint8_t> rgba;
+	uint32_t w, h;
+	if (!loadPng(path, rgba, w, h) || w > 0xFFFF || h > 0xFFFF) return false;
+	a.entry.type = mono ? ASSET_MONO : ASSET_RGB565;
+	a.entry.w = w;
+	a.entry.h = h;
+	uint32_t stride = (w + 7) >> 3;
+	a.data.assign(mono ? stride * h : w * h * 2, 0);
+	for (uint32_t y = 0; y < h; y++)
+	{
+		for (uint32_t x = 0; x < w; x++)
+		{
+			const uint8_t* p = &rgba[(y * w + x) * 4];
+			if (mono)
+			{
+				if (p[3] >= 128 && p[0] * 299 + p[1] * 587 + p[2] * 114 >= 128000) a.data[y * stride + (x >> 3)] |= 0x80 >> (x & 7);
+				continue;
+			}
+			uint16_t c = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+			a.data[(y * w + x) * 2] = c >> 8;
+			a.data[(y * w + x) * 2 + 1] = c & 0xFF;
+		}
+	}
+	return true;
+}
+
+// BDF bitmap rows are hex, byte aligned and MSB first, which is already the
+// 1 bpp layout drawBitmap1bpp takes
+static bool addFont(Asset& a, const char* path)
+{
+	FILE* f = fopen(path, "r");
+	if (f == NULL) return false;
+	char line[512];
+	int ascent = 0, descent = 0, widest = 0;
+	int encoding = -1, advance = 0, bw = 0, bh = 0, bx = 0, by = 0, row = -1;
+	std::vector<uint8_t> bits;
+	a.entry.type = ASSET_FONT;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "FONT_ASCENT %d", &ascent) == 1) continue;
+		if (sscanf(line, "FONT_DESCENT %d", &descent) == 1) continue;
+		if (sscanf(line, "ENCODING %d", &encoding) == 1) continue;
+		if (sscanf(line, "DWIDTH %d", &advance) == 1) continue;
+		if (sscanf(line, "BBX %d %d %d %d", &bw, &bh, &bx, &by) == 4) continue;
+		if (strncmp(line, "STARTCHAR", 9) == 0)
+		{
+			encoding = -1;
+			advance = bw = bh = bx = by = 0;
+			continue;
+		}
+		if (strncmp(line, "BITMAP", 6) == 0)
+		{
+			row = 0;
+			bits.clear();
+			continue;
+		}
+		if (strncmp(line, "ENDCHAR", 7) == 0)
+		{
+			row = -1;
+			if (encoding < 0 || bw > 255 || bh > 255 || advance > 255) continue;
+			int yOffset = ascent - (by + bh);
+			if (bx < -128 || bx > 127 || yOffset < -128 || yOffset > 127)
+			{
+				fprintf(stderr, "%s: glyph %d offset out of range\n", path, encoding);
+				fclose(f);
+				return false;
+			}
+			AssetPackGlyph g;
+			memset(&g, 0, sizeof(g));
+			g.codepoint = encoding;
+			g.offset = a.data.size();
+			g.w = bw;
+			g.h = bh;
+			g.xOffset = bx;
+			g.yOffset = yOffset;
+			g.advance = advance;
+			bits.resize(((bw + 7) >> 3) * bh, 0);
+			a.data.insert(a.data.end(), bits.begin(), bits.end());
+			a.glyphs.push_back(g);
+			if (advance > widest) widest = advance;
+			continue;
+		}
+		if (row >= 0)
+		{
+			uint32_t bytes = (bw + 7) >> 3;
+			for (uint32_t i = 0; i < bytes; i++)
+			{
+				unsigned v = 0;
+				sscanf(line + i * 2, "%2x", &v);
+				bits.push_back(v);
+			}
+			row++;
+		}
+	}
+	fclose(f);
+	if (a.glyphs.empty() || a.glyphs.size() > 0xFFFF) return false;
+	std::sort(a.glyphs.begin(), a.glyphs.end(), [](const AssetPackGlyph& l, const AssetPackGlyph& r) { return l.codepoint < r.codepoint; });
+	// The pack lookup needs strictly increasing codepoints
+	for (size_t i = 1; i < a.glyphs.size(); i++)
+	{
+		if (a.glyphs[i - 1].codepoint == a.glyphs[i].codepoint)
+		{
+			fprintf(stderr, "%s: duplicate ENCODING %u\n", path, (unsigned)a.glyphs[i].codepoint);
+			return false;
+		}
+	}
+	a.entry.glyphs = a.glyphs.size();
+	a.entry.w = widest;
+	a.entry.h = ascent + descent;
+	a.entry.ascent = ascent;
+	return true;
+}
+
+static uint32_t align(uint32_t offset)
+{
+	return (offset + ASSET_PACK_ALIGN - 1) & ~(ASSET_PACK_ALIGN - 1);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s <manifest> <pack>\n", argv[0]);
+		return 1;
+	}
+	FILE* manifest = fopen(argv[1], "r");
+	if (manifest == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+	std::vector<Asset> assets;
+	char line[512], kind[16], name[64], path[400];
+	int lineNo = 0;
+	while (fgets(line, sizeof(line), manifest))
+	{
+		lineNo++;
+		if (line[0] == '#' || sscanf(line, "%15s", kind) != 1) continue;
+		if (sscanf(line, "%15s %63s %399s", kind, name, path) != 3 || strlen(name) >= ASSET_PACK_NAME)
+		{
+			fprintf(stderr, "%s:%d: expected <kind> <name up to %d chars> <file>\n", argv[1], lineNo, ASSET_PACK_NAME - 1);
+			return 1;
+		}
+		Asset a;
+		memset(&a.entry, 0, sizeof(a.entry));
+		strcpy(a.entry.name, name);
+		bool ok;
+		if (strcmp(kind, "image") == 0) ok = addImage(a, path, false);
+		else if (strcmp(kind, "mono") == 0) ok = addImage(a, path, true);
+		else if (strcmp(kind, "font") == 0) ok = addFont(a, path);
+		else
+		{
+			fprintf(stderr, "%s:%d: unknown kind %s\n", argv[1], lineNo, kind);
+			return 1;
+		}
+		if (!ok)
+		{
+			fprintf(stderr, "%s:%d: cannot load %s\n", argv[1], lineNo, path);
+			return 1;
+		}
+		assets.push_back(a);
+	}
+	fclose(manifest);
+	std::sort(assets.begin(), assets.end(), [](const Asset& l, const Asset& r) { return strcmp(l.entry.name, r.entry.name) < 0; });
+	for (size_t i = 1; i < assets.size(); i++)
+	{
+		if (strcmp(assets[i - 1].entry.name, assets[i].entry.name) == 0)
+		{
+			fprintf(stderr, "duplicate asset %s\n", assets[i].entry.name);
+			return 1;
+		}
+	}
+	if (assets.size() > 0xFFFF) return 1;
+
+	// Lay out: header, table, then each block on an ASSET_PACK_ALIGN boundary
+	AssetPackHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.count = assets.size();
+	header.tableOffset = sizeof(header);
+	uint32_t offset = header.tableOffset + assets.size() * sizeof(AssetPackEntry);
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		AssetPackEntry& e = assets[i].entry;
+		offset = align(offset);
+		e.offset = offset;
+		if (e.type == ASSET_FONT)
+		{
+			e.size = assets[i].glyphs.size() * sizeof(AssetPackGlyph);
+			offset = align(offset + e.size);
+			e.dataOffset = offset;
+			offset += assets[i].data.size();
+		}
+		else
+		{
+			e.size = assets[i].data.size();
+			offset += e.size;
+		}
+	}
+	header.fileSize = offset;
+
+	std::vector<uint8_t> out(header.fileSize, 0);
+	memcpy(&out[0], &header, sizeof(header));
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const Asset& a = assets[i];
+		memcpy(&out[header.tableOffset + i * sizeof(AssetPackEntry)], &a.entry, sizeof(a.entry));
+		if (a.entry.type == ASSET_FONT)
+		{
+			memcpy(&out[a.entry.offset], &a.glyphs[0], a.entry.size);
+			if (!a.data.empty()) memcpy(&out[a.entry.dataOffset], &a.data[0], a.data.size());
+		}
+		else if (!a.data.empty()) memcpy(&out[a.entry.offset], &a.data[0], a.data.size());
+	}
+	FILE* f = fopen(argv[2], "wb");
+	if (f == NULL || fwrite(&out[0], 1, out.size(), f) != out.size())
+	{
+		fprintf(stderr, "cannot write %s\n", argv[2]);
+		if (f) fclose(f);
+		return 1;
+	}
+	fclose(f);
+	printf("%s: %u assets, %u bytes\n", argv[2], (unsigned)assets.size(), header.fileSize);
+	return 0;
+}
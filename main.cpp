@@ -4,6 +4,28 @@
 #include <wiringPi.h>
 #include <bcm2835.h>
 #include <math.h>
+
+#define CHART_W 800
+#define CHART_H 160
+#define CHART_Y (480 - CHART_H)
+#define TFT_INT_GPIO 25	// RA8875 INT, BCM numbering
+
+// Renders the battery voltage history as a bar chart into an RGB565 buffer
+static void renderChart(uint16_t* buffer, const float* history, int count, int head)
+{
+	for (int x = 0; x < CHART_W; x++)
+	{
+		float v = history[(head + x * count / CHART_W) % count];
+		int bar = (int)((v - 2.9f) / (4.2f - 2.9f) * CHART_H);
+		if (bar < 0) bar = 0;
+		if (bar > CHART_H) bar = CHART_H;
+		for (int y = 0; y < CHART_H; y++)
+		{
+			buffer[y * CHART_W + x] = (CHART_H - y) <= bar ? RGB(0, 0xC0, 0x40) : ((y & 0x1F) == 0 ? RGB(0x30, 0x30, 0x30) : 0);
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	bcm2835_init();
@@ -16,11 +38,15 @@ int main(int argc, char *argv[])
 	uint16_t tx=0, ty=0;
 	int x=0, y=0, z=0, ix = 0, iy = 0, iz = 0;
 	float t, p, a, a0, a1, a2, a3;
+	float history[CHART_W / 4] = { 0 };
+	int historyHead = 0;
 	bool init = bar->initialize();
 	if (tft->initialize(RA8875_800x480))
 	{
 		tft->setMode(RA8875ModeEnum::TEXT);
 		tft->textColor(RGB(0xFF, 0xFF, 0), 0);
+		tft->startAsync(CHART_W * CHART_H);
+		tft->setInterruptPin(TFT_INT_GPIO);
 	}
 	uint32_t last_time, time;
 	last_time = time = millis();
@@ -43,6 +69,7 @@ int main(int argc, char *argv[])
 	//		}
 
 			j = 0;
+			tft->setActiveWindow(0, 0, tft->get_width() - 1, tft->get_height() - 1);
 			tft->setMode(RA8875ModeEnum::TEXT);
 			tft->textColor(RGB(0xFF, 0xFF, 0), 0);
 			tft->textWrite(0, fh * j++, "TIME %010d", time);
@@ -52,6 +79,24 @@ int main(int argc, char *argv[])
 			//tft->setMode(RA8875ModeEnum::GRAPHIC);
 			//tft->circleHelper(400 + x, 240 - y, 2, RGB(0, 0, 0xFF), true);
 			//tft->circleHelper(tx, ty, 2, RGB(0,0,0xFF), true);
+
+			// The chart upload runs on the SPI I/O thread and overlaps the next
+			// round of I2C sensor reads
+			history[historyHead] = a1;
+			historyHead = (historyHead + 1) % (CHART_W / 4);
+			uint16_t* chart = tft->acquireImageBuffer();
+			if (chart != NULL)
+			{
+				tft->setMode(RA8875ModeEnum::GRAPHIC);
+				renderChart(chart, history, CHART_W / 4, historyHead);
+				tft->drawImageAsync(chart, 0, CHART_Y, CHART_W, CHART_H);
+			}
+		}
+		// Sleep on INT until the next tick instead of spinning
+		uint32_t elapsed = millis() - last_time;
+		if (elapsed <= 1000 && tft->waitInterrupt(1001 - elapsed))
+		{
+			tc = tft->touchRead(&tx, &ty);
 		}
 		time = millis();
 	}